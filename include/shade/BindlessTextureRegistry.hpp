@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+
+/**
+ * Global array of combined image samplers for bindless texturing.
+ *
+ * Textures register into a single descriptor set that stays bound for the
+ *  whole frame; shaders index the array with a per-draw integer (usually
+ *  passed as a push constant) instead of binding a descriptor set per
+ *  texture.
+ *
+ * The array binding is partially bound, update-after-bind and
+ *  update-unused-while-pending, so textures can be registered while command
+ *  buffers using the set are recorded or executing. Slots of unregistered
+ *  textures are only reused once every frame that may sample them has
+ *  finished.
+ *
+ * GLSL declaration:
+ *  layout(set = 1, binding = 0) uniform sampler2D textures[];
+ */
+class BindlessTextureRegistry
+{
+private:
+    VkDevice device;
+
+    uint32_t capacity; // Number of texture slots in the array
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet descriptorSet;
+
+    // Slots that can be handed out again
+    std::vector<uint32_t> freeIndices;
+    uint32_t nextIndex;
+
+    // Unregistered slots that frames in flight may still sample
+    struct RetiringIndex
+    {
+        uint32_t index;
+        uint64_t pendingFrames; // Bit per frame that must begin again first
+    };
+    std::vector<RetiringIndex> retiringIndices;
+    uint32_t frameCount;
+
+    void createDescriptorSetLayout();
+    void createDescriptorSet();
+
+public:
+    /**
+     * Descriptor set index that the texture array is bound to.
+     */
+    static const uint32_t DESCRIPTOR_SET_INDEX = 1;
+
+    /**
+     * Class constructor
+     *
+     * @param device logical device, created with the descriptor indexing
+     *  features enabled
+     * @param capacity number of texture slots in the array
+     * @param frameCount number of frames that may use the set at once (one
+     *  per command buffer), at most 64
+     */
+    BindlessTextureRegistry(VkDevice device, uint32_t capacity, uint32_t frameCount);
+
+    /**
+     * Class destructor
+     */
+    ~BindlessTextureRegistry();
+
+    /**
+     * Add a texture to the array.
+     *
+     * @param imageView image view of the texture
+     * @param sampler sampler of the texture
+     * @returns index of the texture in the array
+     */
+    uint32_t registerTexture(VkImageView imageView, VkSampler sampler);
+
+    /**
+     * Point an existing slot at a different image view and sampler.
+     *
+     * @param index index returned by registerTexture
+     * @param imageView new image view of the texture
+     * @param sampler new sampler of the texture
+     */
+    void updateTexture(uint32_t index, VkImageView imageView, VkSampler sampler);
+
+    /**
+     * Remove a texture from the array. Its slot is reused once every frame
+     *  that was in flight has begun again.
+     *
+     * @param index index returned by registerTexture
+     */
+    void unregisterTexture(uint32_t index);
+
+    /**
+     * Start a frame, releasing the slots that no frame in flight can use.
+     *
+     * The caller must ensure that the GPU has finished with the frame's
+     *  previous command buffer.
+     *
+     * @param frameIndex index of the frame being started
+     */
+    void beginFrame(uint32_t frameIndex);
+
+    /**
+     * Change the number of frames, releasing every unregistered slot. The GPU
+     *  must have finished every frame.
+     */
+    void setFrameCount(uint32_t frameCount);
+
+    /**
+     * Get the number of texture slots in the array.
+     */
+    uint32_t getCapacity();
+
+    VkDescriptorSetLayout _getDescriptorSetLayout();
+    VkDescriptorSet _getDescriptorSet();
+};
+} // namespace Shade
@@ -18,7 +18,8 @@ enum BufferUsage
     INDEX,
     UNIFORM,
     DYNAMIC_UNIFORM,
-    TRANSFER
+    TRANSFER,
+    STORAGE // Read and written by compute shaders
 };
 
 // Buffer storage locations
@@ -50,6 +51,8 @@ private:
     uint32_t totalBufferSize; // Current buffer size in bytes
 
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    MemoryCategory getMemoryCategory();
+    VkBufferCreateInfo getBufferCreateInfo();
     void createBuffer(void *data);
     void fillBuffer(void *data, uint32_t count, uint32_t offset);
     void freeBuffer();
@@ -82,6 +85,17 @@ public:
      */
     VkBuffer _getVkBuffer();
 
+    /**
+     * Get the VMA allocation backing the buffer.
+     */
+    VmaAllocation _getAllocation();
+
+    /**
+     * Recreate the Vulkan buffer after the defragmenter moved its allocation.
+     *  The buffer's handle changes, its contents don't.
+     */
+    void _rebindMemory();
+
     /**
      * Get the total number of elements currently stored inside the buffer.
      *
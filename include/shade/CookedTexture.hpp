@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "./MappedFile.hpp"
+
+namespace Shade
+{
+// A cooked texture file (.stex) holds a CookedTextureHeader, a
+//  CookedTextureLevel per mip level and then the data of every level, largest
+//  first, in the layout expected by vkCmdCopyBufferToImage (tightly packed
+//  rows, or rows of 4x4 blocks for block-compressed formats). Levels start at
+//  multiples of COOKED_TEXTURE_ALIGNMENT so they can be copied as they are.
+const uint32_t COOKED_TEXTURE_MAGIC = 0x58455453; // "STEX"
+const uint32_t COOKED_TEXTURE_VERSION = 1;
+const uint32_t COOKED_TEXTURE_ALIGNMENT = 16;
+
+struct CookedTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format; // VkFormat of the texture
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t flags; // Reserved, written as 0
+    uint32_t reserved;
+};
+
+struct CookedTextureLevel
+{
+    uint64_t offset; // From the start of the file
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+/**
+ * Memory mapped, validated cooked texture file.
+ */
+class CookedTexture
+{
+private:
+    MappedFile file;
+
+    const CookedTextureHeader *header;
+    const CookedTextureLevel *levels;
+
+public:
+    /**
+     * Class constructor, throws if the file isn't a valid cooked texture
+     *
+     * @param path path of the .stex file
+     */
+    CookedTexture(std::string path);
+
+    const CookedTextureHeader &getHeader();
+    const CookedTextureLevel &getLevel(uint32_t level);
+    const uint8_t *getLevelData(uint32_t level);
+
+    /**
+     * Write a cooked texture file.
+     *
+     * @param path path of the file to write
+     * @param format format of the level data
+     * @param width width of the largest level
+     * @param height height of the largest level
+     * @param levels data of every mip level, largest first
+     */
+    static void write(std::string path, VkFormat format, uint32_t width, uint32_t height,
+                      const std::vector<std::vector<uint8_t>> &levels);
+};
+} // namespace Shade
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "./VulkanApplication.hpp"
+
+namespace Shade
+{
+class Buffer;
+class UniformTexture;
+
+struct DefragmentationStats
+{
+    uint64_t passes = 0;
+    uint64_t allocationsMoved = 0;
+    VkDeviceSize bytesMoved = 0;
+    uint64_t memoryBlocksFreed = 0; // VkDeviceMemory blocks released by VMA
+};
+
+/**
+ * Incremental device memory defragmentation.
+ *
+ * Each pass moves a bounded number of allocations towards the fullest memory
+ *  blocks so that emptied blocks can be released. Buffers are compacted with
+ *  VMA's defragmentation; textures (optimal tiling, which VMA can't move
+ *  safely) are copied into a new allocation when one is available in another
+ *  block. Moved objects are rebound in place, so Buffer and UniformTexture
+ *  pointers stay valid and materials pick up the new handles before their next
+ *  draw.
+ */
+class Defragmenter
+{
+private:
+    VulkanApplication *app;
+    VulkanApplicationData *vulkanData;
+
+    std::vector<Buffer *> buffers;
+    std::vector<UniformTexture *> textures;
+    size_t nextTexture; // Textures are visited round-robin across passes
+
+    VkDeviceSize maxBytesPerPass;
+    uint32_t maxMovesPerPass;
+
+    // Incremented by every pass that moves something, see getGeneration
+    uint64_t generation;
+
+    DefragmentationStats stats;
+
+    // Start moving buffers with VMA, by copies recorded into commandBuffer or,
+    //  without one, by the CPU. Budgets are reduced by what was moved.
+    VmaDefragmentationContext beginBufferMoves(VkCommandBuffer commandBuffer,
+                                               VkDeviceSize &bytesLeft, uint32_t &movesLeft,
+                                               std::vector<VkBool32> &allocationsChanged,
+                                               uint64_t &moved);
+
+    // Finish moves once their copies have completed and rebind moved buffers
+    void endBufferMoves(VmaDefragmentationContext context,
+                        const std::vector<VkBool32> &allocationsChanged);
+
+    bool areFramesInFlight();
+    void waitForFramesInFlight();
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param app the application the moved resources belong to
+     * @param maxBytesPerPass maximum number of bytes copied by a single pass
+     * @param maxMovesPerPass maximum number of allocations moved by a single pass
+     */
+    Defragmenter(VulkanApplication *app, VkDeviceSize maxBytesPerPass, uint32_t maxMovesPerPass);
+
+    /**
+     * Make a buffer or texture available for relocation. Called by the
+     *  objects themselves, except staging buffers and textures that are
+     *  still uploading.
+     */
+    void _registerBuffer(Buffer *buffer);
+    void _unregisterBuffer(Buffer *buffer);
+    void _registerTexture(UniformTexture *texture);
+    void _unregisterTexture(UniformTexture *texture);
+
+    /**
+     * Run a single defragmentation pass, between frames.
+     *
+     * Copies are recorded first and only submitted if something moves, after
+     *  waiting for the frames in flight; a pass that moves nothing doesn't
+     *  stall. Buffers moved by the CPU are only moved when no frame is in
+     *  flight.
+     *
+     * @returns true if any allocation was moved
+     */
+    bool runPass();
+
+    /**
+     * Get a counter that changes whenever resources were moved, letting
+     *  holders of raw Vulkan handles know when to fetch them again.
+     */
+    uint64_t getGeneration();
+
+    void setMaxBytesPerPass(VkDeviceSize maxBytesPerPass);
+    void setMaxMovesPerPass(uint32_t maxMovesPerPass);
+
+    DefragmentationStats getStats();
+};
+} // namespace Shade
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+
+/**
+ * Descriptor set allocator that grows on demand.
+ *
+ * Persistent sets are allocated from a list of pools; a new pool is created
+ *  whenever the current one is exhausted or fragmented. Released sets are
+ *  kept per layout and handed out again before any new allocation is made,
+ *  once every frame that may still use them has begun again.
+ *
+ * Transient sets are allocated from per-frame pools that are reset in one go
+ *  when the frame is started again.
+ */
+class DescriptorAllocator
+{
+private:
+    VkDevice device;
+
+    uint32_t setsPerPool;    // Set count of the next persistent pool
+    uint32_t maxSetsPerPool; // Upper limit for persistent pool growth
+
+    // Persistent pools
+    std::vector<VkDescriptorPool> pools;
+    VkDescriptorPool currentPool;
+
+    // Pools that had sets returned to them and may have space again
+    std::set<VkDescriptorPool> reclaimablePools;
+
+    // Released sets waiting to be reused, by layout
+    std::map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeSets;
+
+    // Released sets that frames in flight may still use
+    struct RetiringSet
+    {
+        VkDescriptorSetLayout layout; // VK_NULL_HANDLE once the layout is released
+        VkDescriptorSet set;
+        uint64_t pendingFrames; // Bit per frame that must begin again first
+    };
+    std::vector<RetiringSet> retiringSets;
+
+    // Pool that each persistent set was allocated from
+    std::unordered_map<VkDescriptorSet, VkDescriptorPool> setPools;
+
+    // Transient pools in use by each frame
+    std::vector<std::vector<VkDescriptorPool>> framePools;
+    std::vector<VkDescriptorPool> freeTransientPools;
+    uint32_t currentFrame;
+
+    VkDescriptorPool createPool(uint32_t maxSets, VkDescriptorPoolCreateFlags flags);
+    VkDescriptorPool grabTransientPool();
+    void freeSet(VkDescriptorSet set);
+    void recycleSet(const RetiringSet &retiring);
+    VkResult allocateFromPool(VkDescriptorPool pool, VkDescriptorSetLayout layout,
+                              VkDescriptorSet *set);
+    bool allocateFromReclaimablePools(VkDescriptorSetLayout layout, VkDescriptorSet *set);
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param device logical device to allocate descriptor sets on
+     * @param frameCount number of frames that own transient pools (one per
+     *  command buffer), at most 64
+     * @param setsPerPool number of sets in the first persistent pool, later
+     *  pools double in size up to 'maxSetsPerPool'
+     * @param maxSetsPerPool largest number of sets in a single persistent pool
+     */
+    DescriptorAllocator(VkDevice device, uint32_t frameCount, uint32_t setsPerPool = 256,
+                        uint32_t maxSetsPerPool = 4096);
+
+    /**
+     * Class destructor
+     *
+     * Destroys every pool, freeing all sets allocated by the allocator.
+     */
+    ~DescriptorAllocator();
+
+    /**
+     * Allocate a descriptor set that lives until it is released.
+     *
+     * @param layout layout of the descriptor set
+     * @returns new or recycled descriptor set
+     */
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+
+    /**
+     * Return a descriptor set for reuse by later allocations of the same
+     *  layout, once every frame that was in flight has begun again.
+     *
+     * @param layout layout the set was allocated with
+     * @param set descriptor set to release
+     */
+    void release(VkDescriptorSetLayout layout, VkDescriptorSet set);
+
+    /**
+     * Free every released set of the given layout. Must be called before the
+     *  layout is destroyed.
+     *
+     * @param layout layout that is about to be destroyed
+     */
+    void releaseLayout(VkDescriptorSetLayout layout);
+
+    /**
+     * Allocate a descriptor set that is only valid for the current frame.
+     *
+     * @param layout layout of the descriptor set
+     * @returns descriptor set, freed when the current frame is started again
+     */
+    VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout);
+
+    /**
+     * Start a frame, resetting every transient pool it used previously.
+     *
+     * The caller must ensure that the GPU has finished with the frame's
+     *  previous command buffer.
+     *
+     * @param frameIndex index of the frame being started
+     */
+    void beginFrame(uint32_t frameIndex);
+
+    /**
+     * Change the number of frames, recycling every released set. The GPU must
+     *  have finished every frame.
+     */
+    void setFrameCount(uint32_t frameCount);
+};
+} // namespace Shade
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace Shade
+{
+
+/**
+ * Summary of the frame times (seconds) currently held by FrameStatistics.
+ */
+struct FrameStatisticsSummary
+{
+    uint32_t frameCount = 0; // Frames the percentiles are computed over
+    double p50 = 0;
+    double p95 = 0;
+    double p99 = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+
+    uint64_t totalFrames = 0; // Frames recorded since the last reset
+    uint64_t hitchCount = 0;  // Frames over hitchThreshold times the median
+
+    double framesPerSecond = 0; // Frames completed during the last full second
+};
+
+/**
+ * Rolling frame time statistics.
+ *
+ * Keeps the most recent frame times in a ring buffer and computes percentiles
+ *  over them on request, so recording a frame stays cheap.
+ */
+class FrameStatistics
+{
+private:
+    std::vector<double> frameTimes; // Ring buffer
+    size_t nextFrame;
+    size_t storedFrames;
+
+    double hitchThreshold;
+    uint64_t totalFrames;
+    uint64_t hitchCount;
+
+    // Median used for hitch detection, refreshed periodically
+    double cachedMedian;
+    uint32_t framesSinceMedianUpdate;
+
+    // Throughput
+    double secondElapsed;
+    uint32_t secondFrames;
+    double framesPerSecond;
+
+    static double percentile(std::vector<double> &sortedTimes, double fraction);
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param capacity number of most recent frames the statistics cover
+     * @param hitchThreshold a frame longer than this multiple of the median
+     *  frame time counts as a hitch
+     */
+    FrameStatistics(size_t capacity = 1024, double hitchThreshold = 2.0);
+
+    /**
+     * Record the duration of a frame.
+     *
+     * @param frameTime duration of the frame in seconds
+     */
+    void addFrame(double frameTime);
+
+    /**
+     * Compute the statistics of the recorded frames.
+     */
+    FrameStatisticsSummary getSummary();
+
+    /**
+     * Discard every recorded frame and reset the counters.
+     */
+    void reset();
+
+    /**
+     * Change the multiple of the median frame time that counts as a hitch.
+     */
+    void setHitchThreshold(double hitchThreshold);
+    double getHitchThreshold();
+
+    /**
+     * Write a human-readable summary (in milliseconds) to a stream.
+     *
+     * @param stream stream to write to
+     */
+    void dump(std::ostream &stream);
+};
+} // namespace Shade
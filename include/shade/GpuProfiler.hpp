@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "./VulkanApplication.hpp"
+
+namespace Shade
+{
+
+/**
+ * GPU time statistics of a named scope, in milliseconds.
+ *
+ * Scopes with the same name recorded more than once in a frame are summed into
+ *  a single sample for that frame.
+ */
+struct GpuScopeStats
+{
+    float lastMs = 0;    // Most recent sample
+    float averageMs = 0; // Average over the profiler's history
+    float minMs = 0;
+    float maxMs = 0;
+    uint32_t sampleCount = 0; // Number of samples in the history
+};
+
+/**
+ * GPU profiler based on timestamp queries.
+ *
+ * Each frame in flight owns a range of a timestamp query pool. Results are
+ *  read back when the frame slot is reused, after its fence has been waited
+ *  on, so reading them never stalls the CPU.
+ */
+class GpuProfiler
+{
+private:
+    struct Scope
+    {
+        std::string name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<Scope> scopes;
+        uint32_t queryCount = 0;
+    };
+
+    VulkanApplicationData *vulkanData;
+
+    VkQueryPool queryPool;
+    uint32_t maxQueriesPerFrame;
+
+    std::vector<FrameQueries> frames;
+    uint32_t currentFrame;
+
+    // Scopes begun but not yet ended in the current frame (indices into scopes)
+    std::vector<size_t> openScopes;
+
+    bool supported;
+    float timestampPeriod;  // Nanoseconds per timestamp tick
+    uint64_t timestampMask; // Valid bits of the graphics queue's timestamps
+
+    uint32_t historyLength;
+    std::map<std::string, std::deque<float>> history;
+
+    void createQueryPool(uint32_t frameCount);
+    void readResults(FrameQueries &frame);
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param vulkanData Vulkan data of the application
+     * @param frameCount number of frames in flight
+     * @param maxScopesPerFrame maximum number of scopes recorded per frame,
+     *  further scopes in a frame are ignored
+     * @param historyLength number of frames the statistics are computed over
+     */
+    GpuProfiler(VulkanApplicationData *vulkanData, uint32_t frameCount,
+                uint32_t maxScopesPerFrame = 512, uint32_t historyLength = 120);
+
+    /**
+     * Class destructor
+     */
+    ~GpuProfiler();
+
+    /**
+     * Change the number of frames in flight. The GPU must be idle.
+     */
+    void setFrameCount(uint32_t frameCount);
+
+    /**
+     * Start profiling a frame, collecting the results of the previous frame
+     *  that used the same slot. Must be recorded outside of a render pass.
+     *
+     * @param commandBuffer command buffer of the frame
+     * @param frameIndex frame in flight index, whose previous submission must
+     *  have completed
+     */
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    /**
+     * Start timing a named scope. Scopes may be nested.
+     *
+     * @param commandBuffer command buffer to record the timestamp into
+     * @param name name of the scope
+     */
+    void beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+
+    /**
+     * Stop timing the most recently begun scope.
+     *
+     * @param commandBuffer command buffer to record the timestamp into
+     */
+    void endScope(VkCommandBuffer commandBuffer);
+
+    /**
+     * Check whether the device supports timestamps on the graphics queue. If
+     *  not, the profiler records nothing.
+     */
+    bool isSupported();
+
+    /**
+     * Get the statistics of a scope.
+     *
+     * @param name name of the scope
+     * @returns statistics of the scope, with a sampleCount of '0' if it hasn't
+     *  been recorded yet
+     */
+    GpuScopeStats getScopeStats(const std::string &name);
+
+    /**
+     * Get the statistics of every scope recorded so far, by name.
+     */
+    std::map<std::string, GpuScopeStats> getAllScopeStats();
+
+    /**
+     * Discard all collected samples.
+     */
+    void clearHistory();
+};
+} // namespace Shade
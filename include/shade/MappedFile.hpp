@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Shade
+{
+/**
+ * Read-only memory mapping of a whole file, letting loaders copy data
+ *  straight from the page cache instead of reading it into a buffer first.
+ */
+class MappedFile
+{
+private:
+    const uint8_t *data;
+    size_t size;
+
+#ifdef _WIN32
+    void *fileHandle;
+    void *mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+
+public:
+    /**
+     * Class constructor, throws if the file can't be opened or mapped
+     *
+     * @param path path of the file to map
+     */
+    MappedFile(std::string path);
+
+    /**
+     * Class destructor, unmaps the file
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *getData();
+    size_t getSize();
+};
+} // namespace Shade
@@ -28,6 +28,23 @@ private:
     // Descriptor set used for binding the material
 	VkDescriptorSet descriptorSet;
 
+    // Staged descriptor info for every uniform, in shader layout order
+    std::vector<UniformDescriptorInfo> descriptorInfos;
+    std::vector<bool> assignedUniforms;
+
+    // Objects the descriptor info was taken from, to stage them again after
+    //  the defragmenter moved them
+    std::vector<UniformBufferData> uniformSources;
+    uint64_t defragmentationGeneration;
+
+    // Uniforms changed since the last commit
+    std::vector<bool> dirtyUniforms;
+    bool hasPendingWrites;
+
+    void markUniformDirty(int uniformIndex);
+    void restageMovedUniforms();
+    void collectDescriptorWrites(std::vector<VkWriteDescriptorSet> &writes);
+
     // Offsets for dynamic structured uniform buffers
     std::vector<uint32_t>* dynamicUniformOffsets;
 
@@ -60,6 +77,8 @@ public:
     /**
      * Set the buffer of the uniform at the given index.
      * 
+     * The change is staged and written to the GPU by the next commit.
+     * 
      * @param uniformIndex index of the uniform to modify
      * @param buffer buffer to use
      */
@@ -68,11 +87,28 @@ public:
     /**
      * Set the texture of the uniform at the given index.
      * 
+     * The change is staged and written to the GPU by the next commit.
+     * 
      * @param uniformIndex index of the uniform to modify
      * @param texture texture to use
      */
     void setUniformTexture(int uniformIndex, UniformTexture* texture);
 
+    /**
+     * Write all staged uniform changes to the material's descriptor set.
+     * 
+     * Called automatically before the material is rendered.
+     */
+    void commit();
+
+    /**
+     * Write the staged uniform changes of several materials in a single
+     *  batched update.
+     * 
+     * @param materials materials to commit
+     */
+    static void commitMaterials(const std::vector<Material*>& materials);
+
     /**
      * Get the shader that the material is valid in.
      * 
@@ -84,6 +120,7 @@ public:
      * ~INTERNAL METHOD~
      *  
      *  Return vulkan descriptor sets for binding the material at render time.
+     *  Staged uniform changes are committed first.
      * 
      * @return the material's uniform descriptor sets
      */
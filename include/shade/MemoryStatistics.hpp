@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+struct VulkanApplicationData;
+
+// What a block of device memory is used for
+enum MemoryCategory
+{
+    MEMORY_CATEGORY_VERTEX,
+    MEMORY_CATEGORY_INDEX,
+    MEMORY_CATEGORY_UNIFORM,
+    MEMORY_CATEGORY_TEXTURE,
+    MEMORY_CATEGORY_STAGING,
+    MEMORY_CATEGORY_ATTACHMENT, // Depth and other render targets
+
+    MEMORY_CATEGORY_COUNT
+};
+
+/**
+ * Usage and budget of a single Vulkan memory heap, in bytes.
+ */
+struct MemoryHeapStatistics
+{
+    VkDeviceSize size = 0; // Total size of the heap
+    bool deviceLocal = false;
+
+    VkDeviceSize blockBytes = 0;      // Memory allocated from the heap by VMA
+    VkDeviceSize allocationBytes = 0; // Part of blockBytes occupied by allocations
+
+    // Estimated usage of the whole process and memory available to it; reported
+    //  by the driver with VK_EXT_memory_budget, otherwise estimated by VMA
+    VkDeviceSize usage = 0;
+    VkDeviceSize budget = 0;
+
+    VkDeviceSize largestFreeBlock = 0; // Largest unused range within VMA's blocks
+};
+
+/**
+ * Live allocations of a MemoryCategory.
+ */
+struct MemoryCategoryStatistics
+{
+    uint64_t allocationCount = 0;
+    VkDeviceSize bytes = 0;
+};
+
+struct MemoryReport
+{
+    std::vector<MemoryHeapStatistics> heaps;
+    MemoryCategoryStatistics categories[MEMORY_CATEGORY_COUNT];
+
+    VkDeviceSize largestFreeBlock = 0; // Largest over every heap
+
+    bool budgetFromDriver = false; // VK_EXT_memory_budget is in use
+};
+
+/**
+ * Tracks device memory allocations by category and watches the per-heap
+ *  memory budget, warning before allocations start to fail.
+ */
+class MemoryStatistics
+{
+private:
+    VulkanApplicationData *vulkanData;
+
+    std::atomic<uint64_t> categoryCounts[MEMORY_CATEGORY_COUNT];
+    std::atomic<uint64_t> categoryBytes[MEMORY_CATEGORY_COUNT];
+
+    float warningThreshold;
+
+    // Heaps that were over the warning threshold at the last check, so each
+    //  crossing is only reported once
+    std::vector<bool> heapsOverThreshold;
+
+    uint32_t frameIndex;
+
+    uint32_t getHeapCount();
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param vulkanData application data, the VMA allocator must already exist
+     * @param warningThreshold fraction of a heap's budget at which a warning
+     *  is logged
+     */
+    MemoryStatistics(VulkanApplicationData *vulkanData, float warningThreshold = 0.9f);
+
+    /**
+     * Record a device memory allocation or its release.
+     *
+     * @param category what the memory is used for
+     * @param bytes size of the allocation
+     */
+    void _trackAllocation(MemoryCategory category, VkDeviceSize bytes);
+    void _trackFree(MemoryCategory category, VkDeviceSize bytes);
+
+    /**
+     * Advance VMA's frame index (which refreshes the driver reported budget)
+     *  and check the budget. Called once per frame by the application.
+     */
+    void beginFrame();
+
+    /**
+     * Log a warning for every heap whose usage has crossed the warning
+     *  threshold since the last check.
+     */
+    void checkBudget();
+
+    /**
+     * Gather heap usage, budgets, category counts and the largest free block.
+     *
+     * Walks every VMA block, so prefer not to call this every frame.
+     */
+    MemoryReport getReport();
+
+    void setWarningThreshold(float warningThreshold);
+    float getWarningThreshold();
+
+    /**
+     * Write a human-readable report (in MiB) to a stream.
+     *
+     * @param stream stream to write to
+     */
+    void dump(std::ostream &stream);
+
+    /**
+     * Get a printable name of a memory category.
+     */
+    static const char *getCategoryName(MemoryCategory category);
+};
+} // namespace Shade
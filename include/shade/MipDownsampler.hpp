@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "./VulkanApplication.hpp"
+
+namespace Shade
+{
+class Buffer;
+
+// Largest mip chain generated by a single dispatch, starting from a first
+//  level of up to 4096x4096
+static const uint32_t MIP_DOWNSAMPLER_MAX_LEVELS = 12;
+static const uint32_t MIP_DOWNSAMPLER_MAX_SIZE = 4096;
+
+/**
+ * Single pass mip chain generation with a compute shader, for images whose
+ *  first level changes every frame such as reflection probes and render
+ *  targets.
+ *
+ * Modelled on AMD's single pass downsampler: every workgroup reduces a 64x64
+ *  tile of the first level to levels 1-6 in shared memory, and the last
+ *  workgroup to finish reduces the tiles' level 6 texels to levels 7-12. Up to
+ *  12 levels are built by one dispatch, without the barrier between levels
+ *  of blitted mipmaps. Levels are 2x2 averages, like blitted mipmaps, and
+ *  sRGB images are filtered in linear space.
+ *
+ * Created by the application when the device can write storage images
+ *  without a declared format and Shade was built with glslc, see
+ *  ShadeApplication::getMipDownsampler. Images are registered through
+ *  MipDownsampleTarget.
+ */
+class MipDownsampler
+{
+private:
+    VulkanApplication *app;
+    VulkanApplicationData *vulkanData;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+
+    // Linear clamp to edge sampler reading the first level
+    VkSampler sampler;
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param app the application the downsampled images belong to, must
+     *  have a descriptor allocator and pipeline cache
+     */
+    MipDownsampler(VulkanApplication *app);
+
+    /**
+     * Class destructor
+     *
+     * Every MipDownsampleTarget must have been destroyed.
+     */
+    ~MipDownsampler();
+
+    /**
+     * Check whether mip chains of a format can be generated, which requires
+     *  linear filtering and storage image support (of the UNORM equivalent
+     *  for sRGB formats).
+     */
+    bool isFormatSupported(VkFormat format);
+
+    /**
+     * Get the creation flags and usage an image needs to be downsampled, in
+     *  addition to those of its other uses.
+     */
+    static VkImageCreateFlags getImageCreateFlags(VkFormat format);
+    static VkImageUsageFlags getImageUsage();
+
+    /**
+     * Check whether the device and build support compute mip generation.
+     */
+    static bool _isSupported(VulkanApplicationData *vulkanData);
+
+    VkDescriptorSetLayout _getDescriptorSetLayout();
+    VkPipelineLayout _getPipelineLayout();
+    VkPipeline _getPipeline();
+    VkSampler _getSampler();
+};
+
+/**
+ * An image whose mip chain is generated from its first level by the
+ *  application's MipDownsampler.
+ *
+ * Holds the per-level views, descriptor set and buffers used by the
+ *  dispatch, so that generating the chain every frame allocates nothing.
+ */
+class MipDownsampleTarget
+{
+private:
+    VulkanApplication *app;
+    VulkanApplicationData *vulkanData;
+    MipDownsampler *downsampler;
+
+    VkImage image;
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+
+    uint32_t tilesX; // Workgroups of the dispatch, one per 64x64 tile
+    uint32_t tilesY;
+
+    VkImageView sourceView;               // First level, sampled
+    std::vector<VkImageView> levelViews; // Every other level, as storage images
+
+    Buffer *level6Buffer; // Level 6 texel of every tile
+    Buffer *counterBuffer;
+
+    VkDescriptorSet descriptorSet;
+
+    // Buffers are rebound when the defragmenter moves them
+    uint64_t defragmentationGeneration;
+
+    VkImageView createLevelView(VkFormat viewFormat, uint32_t level);
+    void writeDescriptorSet();
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param app the application the image belongs to
+     * @param image image created with the flags and usage given by
+     *  MipDownsampler::getImageCreateFlags and getImageUsage
+     * @param format format of the image, see MipDownsampler::isFormatSupported
+     * @param width width of the first level, at most MIP_DOWNSAMPLER_MAX_SIZE
+     * @param height height of the first level, at most MIP_DOWNSAMPLER_MAX_SIZE
+     * @param mipLevels number of levels of the image, including the first,
+     *  from 2 to MIP_DOWNSAMPLER_MAX_LEVELS + 1
+     */
+    MipDownsampleTarget(VulkanApplication *app, VkImage image, VkFormat format, uint32_t width,
+                        uint32_t height, uint32_t mipLevels);
+
+    /**
+     * Class destructor
+     *
+     * The GPU must have finished every recorded generation.
+     */
+    ~MipDownsampleTarget();
+
+    /**
+     * Record the generation of every level after the first, outside of a
+     *  render pass. Previous contents of those levels are discarded.
+     *
+     * @param commandBuffer command buffer to record into, or VK_NULL_HANDLE to
+     *  submit single time commands and wait for them to complete
+     * @param oldLayout layout of the first level, which was last written by
+     *  any earlier command
+     * @param newLayout layout of every level afterwards, ready to be read by
+     *  any later command
+     */
+    void generate(VkCommandBuffer commandBuffer = VK_NULL_HANDLE,
+                  VkImageLayout oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                  VkImageLayout newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+};
+} // namespace Shade
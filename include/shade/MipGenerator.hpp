@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+class ThreadPool;
+
+enum MipFilter
+{
+    MIP_FILTER_BOX,   // Average of the covered texels, matching a linear blit
+    MIP_FILTER_KAISER // Kaiser windowed sinc, sharper levels with little aliasing
+};
+
+/**
+ * CPU generation of mip chains for uncompressed formats, used for formats
+ *  that can't be blitted and by the texture cooker.
+ *
+ * Each level is filtered from the previous one in linear space: sRGB formats
+ *  are linearised first and, with alpha weighting, colour is weighted by
+ *  alpha so that transparent texels don't bleed into their neighbours.
+ *  Channels are kept in separate planes so that the filter loops are
+ *  vectorised by the compiler, and every level is split by rows across a
+ *  thread pool.
+ */
+class MipGenerator
+{
+private:
+    ThreadPool *threadPool;
+    MipFilter filter;
+    bool alphaWeighted;
+
+    void forEachRowRange(uint32_t rows, uint32_t texelsPerRow,
+                         const std::function<void(uint32_t, uint32_t)> &work);
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param threadPool pool to filter on, or nullptr to filter on the calling
+     *  thread. Must not be called from a task running on the same pool.
+     * @param filter filter used to reduce each level
+     * @param alphaWeighted weight colour by alpha, for images whose alpha is
+     *  opacity rather than unrelated data
+     */
+    MipGenerator(ThreadPool *threadPool = nullptr, MipFilter filter = MIP_FILTER_BOX,
+                 bool alphaWeighted = true);
+
+    /**
+     * Generate the mip chain of an image, down to 1x1.
+     *
+     * @param pixels tightly packed pixels of the full size image
+     * @param width width of the image
+     * @param height height of the image
+     * @param format format of the pixels and the generated levels, see
+     *  TextureFormat::isConvertible
+     * @returns every level, starting with a copy of the full size image
+     */
+    std::vector<std::vector<uint8_t>> generate(const void *pixels, uint32_t width,
+                                               uint32_t height, VkFormat format);
+
+    void setFilter(MipFilter filter);
+    MipFilter getFilter();
+
+    void setAlphaWeighted(bool alphaWeighted);
+    bool isAlphaWeighted();
+
+    /**
+     * Get the number of levels in a full mip chain of an image.
+     */
+    static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+};
+} // namespace Shade
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+
+/**
+ * Pipeline cache shared by every shader, persisted between runs.
+ *
+ * The cache is loaded from a file named after the device's pipeline cache UUID
+ *  and driver version, so a driver update or a different GPU starts with an
+ *  empty cache instead of handing incompatible data to the driver.
+ */
+class PipelineCache
+{
+private:
+    VkDevice device;
+
+    VkPipelineCache pipelineCache;
+
+    // Full path of the cache file, empty if the cache isn't persisted
+    std::string filePath;
+
+    std::vector<char> readCacheFile(const VkPhysicalDeviceProperties &properties);
+    static bool isCacheDataCompatible(const std::vector<char> &data,
+                                      const VkPhysicalDeviceProperties &properties);
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param device logical device to create the cache on
+     * @param properties properties of the physical device, used to key the
+     *  cache file
+     * @param directory directory the cache file is stored in, or an empty
+     *  string to keep the cache in memory only
+     */
+    PipelineCache(VkDevice device, const VkPhysicalDeviceProperties &properties,
+                  std::string directory);
+
+    /**
+     * Class destructor
+     */
+    ~PipelineCache();
+
+    /**
+     * Write the contents of the cache to disk.
+     *
+     * Failures are not fatal; the next run simply compiles from scratch.
+     */
+    void save();
+
+    /**
+     * Get the path of the cache file.
+     */
+    std::string getFilePath();
+
+    VkPipelineCache _getVkPipelineCache();
+};
+} // namespace Shade
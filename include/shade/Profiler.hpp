@@ -0,0 +1,109 @@
+/**
+ * CPU profiling zones:
+ *  Scoped zones are recorded into a per-thread ring buffer and can be
+ *  exported as a Chrome trace (chrome://tracing or https://ui.perfetto.dev).
+ *
+ *  Zones are compiled out unless SHADE_ENABLE_PROFILING is defined (CMake
+ *  option of the same name).
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifdef SHADE_ENABLE_PROFILING
+#define SHADE_PROFILE_CONCAT_INNER(a, b) a##b
+#define SHADE_PROFILE_CONCAT(a, b) SHADE_PROFILE_CONCAT_INNER(a, b)
+
+// Time the enclosing scope; 'name' must be a string literal (or otherwise
+//  outlive the profiler) as only the pointer is recorded
+#define SHADE_PROFILE_ZONE(name)                                                                 \
+    Shade::ProfilerZone SHADE_PROFILE_CONCAT(shadeProfilerZone, __LINE__)(name)
+#define SHADE_PROFILE_FUNCTION() SHADE_PROFILE_ZONE(__func__)
+#else
+#define SHADE_PROFILE_ZONE(name)
+#define SHADE_PROFILE_FUNCTION()
+#endif
+
+namespace Shade
+{
+
+struct ProfilerEvent
+{
+    const char *name;
+    uint64_t startNs; // Nanoseconds since profiler start
+    uint64_t endNs;
+};
+
+/**
+ * Ring buffer of events recorded by a single thread.
+ *
+ * Only the owning thread writes, so recording needs no locks; old events are
+ *  overwritten once the buffer is full.
+ */
+struct ProfilerThreadBuffer
+{
+    static const uint32_t CAPACITY = 65536;
+
+    uint32_t threadId;
+    std::atomic<uint64_t> writeCount; // Total number of events ever written
+    ProfilerEvent events[CAPACITY];
+};
+
+class Profiler
+{
+public:
+    /**
+     * Get the current time in nanoseconds since the profiler started.
+     */
+    static uint64_t now();
+
+    /**
+     * Record a completed zone on the calling thread.
+     *
+     * @param name name of the zone, must outlive the profiler
+     * @param startNs start time of the zone (from Profiler::now)
+     * @param endNs end time of the zone (from Profiler::now)
+     */
+    static void record(const char *name, uint64_t startNs, uint64_t endNs);
+
+    /**
+     * Write every recorded zone to a Chrome trace_event JSON file.
+     *
+     * Best called while no zones are being recorded (e.g. on shutdown), as
+     *  events written during the export may appear torn.
+     *
+     * @param path path of the JSON file to write
+     */
+    static void exportChromeTrace(const std::string &path);
+
+    /**
+     * Discard every recorded zone. Must not be called while other threads are
+     *  recording zones.
+     */
+    static void clear();
+
+    /**
+     * Check whether profiling zones were compiled in.
+     */
+    static bool isEnabled();
+
+    static ProfilerThreadBuffer *_getThreadBuffer();
+};
+
+/**
+ * Records the lifetime of the object as a zone, see SHADE_PROFILE_ZONE.
+ */
+class ProfilerZone
+{
+private:
+    const char *name;
+    uint64_t startNs;
+
+public:
+    ProfilerZone(const char *name) : name(name), startNs(Profiler::now()) {}
+    ~ProfilerZone() { Profiler::record(name, startNs, Profiler::now()); }
+};
+} // namespace Shade
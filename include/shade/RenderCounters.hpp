@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Shade
+{
+
+/**
+ * Renderer work counted over a frame (or since startup).
+ */
+struct RenderCounters
+{
+    uint64_t drawCalls = 0;
+    uint64_t indicesSubmitted = 0;
+
+    uint64_t pipelineBinds = 0;
+    uint64_t descriptorSetBinds = 0;
+    uint64_t vertexBufferBinds = 0;
+    uint64_t indexBufferBinds = 0;
+
+    uint64_t bufferUploads = 0; // Buffer::fillBuffer calls
+    uint64_t bytesUploaded = 0; // Bytes written by Buffer::fillBuffer
+    uint64_t bytesStaged = 0;   // Part of bytesUploaded copied through a staging buffer
+
+    // Submissions that waited for the GPU to go idle (_endSingleTimeCommands)
+    uint64_t singleTimeCommandStalls = 0;
+
+    uint64_t descriptorSetsAllocated = 0;
+    uint64_t pipelinesCreated = 0;
+
+    RenderCounters &operator+=(const RenderCounters &other);
+};
+
+/**
+ * Thread-safe counterpart of RenderCounters that Shade objects increment.
+ *
+ * Increments are relaxed atomics, so counting is cheap enough to stay enabled
+ *  and works from worker threads (e.g. asynchronous pipeline compilation).
+ */
+struct AtomicRenderCounters
+{
+    std::atomic<uint64_t> drawCalls{0};
+    std::atomic<uint64_t> indicesSubmitted{0};
+
+    std::atomic<uint64_t> pipelineBinds{0};
+    std::atomic<uint64_t> descriptorSetBinds{0};
+    std::atomic<uint64_t> vertexBufferBinds{0};
+    std::atomic<uint64_t> indexBufferBinds{0};
+
+    std::atomic<uint64_t> bufferUploads{0};
+    std::atomic<uint64_t> bytesUploaded{0};
+    std::atomic<uint64_t> bytesStaged{0};
+
+    std::atomic<uint64_t> singleTimeCommandStalls{0};
+
+    std::atomic<uint64_t> descriptorSetsAllocated{0};
+    std::atomic<uint64_t> pipelinesCreated{0};
+
+    /**
+     * Increment a counter.
+     *
+     * @param counter counter to increment
+     * @param amount amount to add
+     */
+    static void add(std::atomic<uint64_t> &counter, uint64_t amount = 1)
+    {
+        counter.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    /**
+     * Read every counter and reset them to zero.
+     *
+     * @returns the counter values before the reset
+     */
+    RenderCounters collect();
+};
+} // namespace Shade
@@ -17,6 +17,25 @@
 #include "./Buffer.hpp"
 #include "./StructuredBuffer.hpp"
 #include "./StructuredUniformBuffer.hpp"
+#include "./DescriptorAllocator.hpp"
+#include "./BindlessTextureRegistry.hpp"
+#include "./PipelineCache.hpp"
+#include "./ThreadPool.hpp"
+#include "./GpuProfiler.hpp"
+#include "./Profiler.hpp"
+#include "./FrameStatistics.hpp"
+#include "./RenderCounters.hpp"
+#include "./MemoryStatistics.hpp"
+#include "./Defragmenter.hpp"
+#include "./UploadBatch.hpp"
+#include "./TextureLoader.hpp"
+#include "./MappedFile.hpp"
+#include "./CookedTexture.hpp"
+#include "./TextureFormat.hpp"
+#include "./TextureContainer.hpp"
+#include "./TextureEncoder.hpp"
+#include "./MipGenerator.hpp"
+#include "./MipDownsampler.hpp"
 #include "./IndexBuffer.hpp"
 #include "./VertexBuffer.hpp"
 #include "./UniformTexture.hpp"
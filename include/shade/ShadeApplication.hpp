@@ -12,9 +12,15 @@
 
 #include "./Buffer.hpp"
 #include "./Colour.hpp"
+#include "./Defragmenter.hpp"
+#include "./TextureLoader.hpp"
+#include "./FrameStatistics.hpp"
+#include "./GpuProfiler.hpp"
 #include "./IndexBuffer.hpp"
+#include "./MemoryStatistics.hpp"
 #include "./Mesh.hpp"
 #include "./Rect.hpp"
+#include "./RenderCounters.hpp"
 #include "./Shade.hpp"
 #include "./Shader.hpp"
 #include "./VertexBuffer.hpp"
@@ -128,6 +134,14 @@ enum Key
     SHADE_KEY_TAB = GLFW_KEY_TAB
 };
 
+enum PresentMode
+{
+    PRESENT_MODE_FIFO,         // Vsync, always supported
+    PRESENT_MODE_FIFO_RELAXED, // Vsync, but late frames are shown immediately and may tear
+    PRESENT_MODE_MAILBOX,      // No tearing, queued frames are replaced by newer ones
+    PRESENT_MODE_IMMEDIATE     // No vsync, lowest latency, may tear
+};
+
 struct ShadeApplicationInfo
 {
     std::string windowTitle = "Shade Application";
@@ -136,6 +150,68 @@ struct ShadeApplicationInfo
     bool windowFullscreen = false;
     bool mouseLock = false;
     Colour clearColour = {0, 0, 0, 1};
+
+    // Unsupported present modes fall back to PRESENT_MODE_FIFO
+    PresentMode presentMode = PRESENT_MODE_MAILBOX;
+
+    // Number of swapchain images (0 to use one more than the surface minimum)
+    uint32_t swapchainImageCount = 0;
+
+    // Number of frames the CPU may record ahead of the GPU. With 1, update()
+    //  runs once the previous frame has finished on the GPU. Higher values
+    //  increase throughput, but the GPU may then still be reading the previous
+    //  frames' data during update(): buffers written every frame (including
+    //  CPU storage buffers, which are written in place) need one copy per
+    //  frame in flight
+    uint32_t maxFramesInFlight = 1;
+
+    // Measure GPU time of every frame and of scopes begun with beginGpuScope,
+    //  and optionally of every individual draw ("Draw <n>" scopes)
+    bool gpuProfiling = false;
+    bool gpuProfileDraws = false;
+
+    // Write frame time percentiles to stdout when the application exits
+    bool printFrameStatisticsOnExit = false;
+
+    // Warn once a memory heap's usage reaches this fraction of its budget
+    float memoryBudgetWarningThreshold = 0.9f;
+
+    // Compact buffer and texture memory in small passes, for long running
+    //  applications that keep loading and unloading resources. A pass runs at
+    //  most every defragmentationInterval frames while no texture is loading,
+    //  and only waits for the frames in flight to complete if it moves something
+    bool defragmentation = false;
+    uint32_t defragmentationInterval = 60;
+    VkDeviceSize defragmentationMaxBytesPerPass = 16 * 1024 * 1024;
+    uint32_t defragmentationMaxMovesPerPass = 16;
+
+    // Register every texture into a global array that shaders created with
+    //  ShaderFlags::BINDLESS_TEXTURES can index (requires descriptor indexing)
+    bool bindlessTextures = false;
+    uint32_t maxBindlessTextures = 4096;
+
+    // Directory the pipeline cache is loaded from and saved to, keeping
+    //  compiled pipelines between runs (empty to disable)
+    std::string pipelineCacheDirectory = ".";
+
+    // Number of worker threads used for background work such as compiling
+    //  ShaderFlags::ASYNC_COMPILE shaders (0 to use every core but one)
+    uint32_t workerThreadCount = 0;
+
+    // Maximum number of bytes of background loaded textures uploaded per frame
+    VkDeviceSize textureUploadBytesPerFrame = 32 * 1024 * 1024;
+};
+
+// Pipeline state bound by the previous draw in the current command buffer
+struct BoundRenderState
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    std::vector<uint32_t> dynamicUniformOffsets;
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    int indexBufferOffset = 0;
 };
 
 struct QueueFamilyIndices
@@ -167,6 +243,9 @@ private:
 
     const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
+    const std::vector<const char *> bindlessDeviceExtensions = {
+        VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME};
+
     void initSystem();
     void initWindow();
     void initVulkan();
@@ -177,11 +256,16 @@ private:
     void pickPhysicalDevice();
     bool isDeviceSuitable(VkPhysicalDevice device);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
-    bool checkDeviceExtensionsSupport(VkPhysicalDevice device);
+    bool checkDeviceExtensionsSupport(VkPhysicalDevice device,
+                                      const std::vector<const char *> &extensions);
+    bool checkBindlessTextureSupport(VkPhysicalDevice device);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
     void createLogicalDevice();
     void createAllocator();
-    void createSwapchain();
+    void createMemoryStatistics();
+    void createDefragmenter();
+    void createTextureLoader();
+    void createSwapchain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
     VkExtent2D getOptimalSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities);
     VkPresentModeKHR
     getOptimalSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes);
@@ -190,29 +274,65 @@ private:
     void createImageViews();
     void createRenderPass();
     void createFramebuffers();
-    void createSemaphores();
+    void createSyncObjects();
+    void cleanupSyncObjects();
+    void waitForFramesInFlight();
+    void waitForFrameSlot();
     void createCommandPool();
     void createCommandBuffers();
-    void createDescriptorPool();
+    void createDescriptorAllocator();
+    void createBindlessTextureRegistry();
+    void createPipelineCache();
+    void createMipDownsampler();
+    void createThreadPool();
+    void createGpuProfiler();
     void createDepthResources();
 
     static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
-    void recreateSwapchain();
+    bool recreateSwapchain();
     void cleanupSwapchain();
     void cleanupDepthResources();
 
     void updateFrameData();
 
-    void renderStart();
+    bool renderStart();
     void renderPresent();
 
+    // Set when the swapchain no longer matches the window; resize events are
+    //  coalesced and the swapchain is recreated once, before the next frame
+    bool swapchainOutOfDate = false;
+
+    // Set when maxFramesInFlight changes, handled before the next frame
+    bool syncObjectsOutOfDate = false;
+
+    // Time (seconds) of the previous present call, and the intervals between them
+    double prevPresentTime = 0;
+    double presentInterval = 0;
+    double averagePresentInterval = 0;
+
+    // Used to skip redundant binds between consecutive draws
+    BoundRenderState boundState;
+
+    uint32_t framesSinceDefragmentation = 0;
+
+    // nullptr unless gpuProfiling is enabled
+    GpuProfiler *gpuProfiler = nullptr;
+    uint32_t drawIndex = 0; // Draws recorded in the current frame
+
     void updateMouseData();
 
     bool running;
 
-    float prevTime = 0;       // Keep track of application time for calculating delta time
+    double prevTime = 0;      // Keep track of application time for calculating delta time
     float fixedDeltaTime = 0; // Delta time (seconds) since last frame
 
+    FrameStatistics frameStatistics;
+
+    // Counters of the frame being recorded, collected once per frame
+    AtomicRenderCounters renderCounters;
+    RenderCounters frameCounters; // Last completed frame
+    RenderCounters totalCounters; // Since startup
+
     /**
      * Keep track of loaded shaders for updating on window resize events.
      */
@@ -250,9 +370,57 @@ public:
     void setMouseLock(bool mouseLock);
     bool getMouseLock();
 
-    void renderMesh(Mesh *mesh, Material *material);
+    /**
+     * Change the present mode, recreating the swapchain before the next frame.
+     *
+     * @param presentMode requested present mode, PRESENT_MODE_FIFO is used if
+     *  the surface doesn't support it
+     */
+    void setPresentMode(PresentMode presentMode);
+    PresentMode getPresentMode();
+
+    /**
+     * Change the number of swapchain images, recreating the swapchain before
+     *  the next frame.
+     *
+     * @param imageCount number of images, clamped to the surface limits ('0'
+     *  to use one more than the surface minimum)
+     */
+    void setSwapchainImageCount(uint32_t imageCount);
+    uint32_t getSwapchainImageCount();
+
+    /**
+     * Limit the number of frames the CPU may record ahead of the GPU, see
+     *  ShadeApplicationInfo::maxFramesInFlight. Values above 1 need per-frame
+     *  copies of buffers written every frame.
+     *
+     * @param maxFramesInFlight maximum number of frames in flight (at least 1)
+     */
+    void setMaxFramesInFlight(uint32_t maxFramesInFlight);
+    uint32_t getMaxFramesInFlight();
+
+    /**
+     * Get the time (seconds) between the two most recent presents, measured on
+     *  the CPU when vkQueuePresentKHR returns.
+     */
+    float getPresentInterval();
+
+    /**
+     * Get the present interval (seconds), smoothed over recent frames.
+     */
+    float getAveragePresentInterval();
+
+    /**
+     * Render a mesh using the given material.
+     *
+     * @param mesh mesh to render
+     * @param material material to render the mesh with
+     * @param pushConstantData optional per-draw push constant data; unaligned data for every
+     *  push constant entry of the material's shader, in declaration order
+     */
+    void renderMesh(Mesh *mesh, Material *material, void *pushConstantData = nullptr);
     void renderTriangles(VertexBuffer *vertexBuffer, IndexBuffer *indexBuffer, Material *material,
-                         int indexBufferOffset = 0);
+                         int indexBufferOffset = 0, void *pushConstantData = nullptr);
 
     ShadeApplicationInfo *_getApplicationInfo();
     void _registerShader(Shader *shader);
@@ -264,6 +432,25 @@ public:
      */
     float getFixedDeltaTime();
 
+    /**
+     * Get the frame time statistics of the application, e.g. to query
+     *  percentiles from update().
+     */
+    FrameStatistics *getFrameStatistics();
+
+    /**
+     * Get the renderer work (draws, binds, uploads, stalls etc.) of the last
+     *  completed frame. A frame spans from one update() call to the next, so
+     *  uploads made in update() count towards the frame they precede.
+     */
+    RenderCounters getFrameCounters();
+
+    /**
+     * Get the renderer work accumulated since startup, including work done
+     *  before the first frame (e.g. in init()).
+     */
+    RenderCounters getTotalCounters();
+
     /**
      * Get total time (seconds) since application startup
      */
@@ -275,5 +462,49 @@ public:
     Mouse getMouse();
 
     GLFWwindow *_getGLFWWindow();
+
+    /**
+     * Get the GPU profiler.
+     *
+     * @returns the profiler, or nullptr if gpuProfiling isn't enabled in
+     *  ShadeApplicationInfo
+     */
+    GpuProfiler *getGpuProfiler();
+
+    /**
+     * Get the device memory statistics: per-heap usage and budget, allocations
+     *  by category and the largest free block.
+     */
+    MemoryStatistics *getMemoryStatistics();
+
+    /**
+     * Get the memory defragmenter, e.g. to adjust its per-pass budget.
+     *
+     * @returns the defragmenter, or nullptr if defragmentation isn't enabled
+     *  in ShadeApplicationInfo
+     */
+    Defragmenter *getDefragmenter();
+
+    /**
+     * Get the background texture loader.
+     */
+    TextureLoader *getTextureLoader();
+
+    /**
+     * Get the compute mip chain generator, used through MipDownsampleTarget.
+     *
+     * @returns the downsampler, or nullptr if the device or build doesn't
+     *  support compute mip generation
+     */
+    MipDownsampler *getMipDownsampler();
+
+    /**
+     * Start measuring the GPU time of the draws that follow, until the
+     *  matching endGpuScope call. Does nothing if GPU profiling is disabled.
+     *
+     * @param name name of the scope, scopes with the same name are summed
+     */
+    void beginGpuScope(const std::string &name);
+    void endGpuScope();
 };
 } // namespace Shade
\ No newline at end of file
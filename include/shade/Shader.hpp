@@ -1,12 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <future>
 #include <string>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
 #include <vulkan/vulkan.h>
 
+#include "./BindlessTextureRegistry.hpp"
+#include "./DescriptorAllocator.hpp"
+#include "./PipelineCache.hpp"
 #include "./StructuredBuffer.hpp"
+#include "./ThreadPool.hpp"
 #include "./UniformTexture.hpp"
 #include "./VulkanApplication.hpp"
 
@@ -16,7 +23,14 @@ enum ShaderFlags
 {
     DISABLE_DEPTH_TEST = 1,
     DISABLE_DEPTH_WRITE = 2,
-    WIREFRAME = 4
+    WIREFRAME = 4,
+    // Bind the application's global texture array to descriptor set 1; the
+    //  texture index is passed per draw through push constants
+    BINDLESS_TEXTURES = 8,
+    // Compile the pipeline on a worker thread; the constructor returns
+    //  immediately and draws are skipped (or use the fallback shader) until
+    //  the shader is ready
+    ASYNC_COMPILE = 16
 };
 
 enum ShaderStage
@@ -34,23 +48,63 @@ struct UniformLayoutEntry
     bool dynamic = false;
 };
 
+/**
+ * Push constant range declared by a shader.
+ *
+ * Entries are laid out in declaration order inside the shader's push constant
+ *  block, each starting on a 16 byte boundary.
+ */
+struct PushConstantLayoutEntry
+{
+    std::string name;
+    uint32_t stage; // Shader Stage (use ShaderStage bits)
+    StructuredBufferLayout layout;
+};
+
+/**
+ * Descriptor info of a single uniform, as staged by materials.
+ *
+ * Materials keep one entry per uniform in layout order, which is also the
+ *  data layout expected by the shader's descriptor update template.
+ */
+union UniformDescriptorInfo
+{
+    VkDescriptorBufferInfo bufferInfo;
+    VkDescriptorImageInfo imageInfo;
+};
+
 class ShaderLayout
 {
 private:
 public:
     std::vector<UniformLayoutEntry> uniformsLayout;
     StructuredBufferLayout vertexLayout;
+    std::vector<PushConstantLayoutEntry> pushConstantsLayout;
 
     ShaderLayout()
     {
         uniformsLayout = {};
         vertexLayout = {};
+        pushConstantsLayout = {};
     }
     ShaderLayout(std::vector<UniformLayoutEntry> uniformsLayout,
-                 StructuredBufferLayout vertexLayout);
+                 StructuredBufferLayout vertexLayout,
+                 std::vector<PushConstantLayoutEntry> pushConstantsLayout = {});
     ~ShaderLayout();
 
     std::vector<uint32_t> getDynamicUniformStrides(VulkanApplication *app);
+    /**
+     * Get the offset and size of every push constant entry, in declaration
+     *  order. Each has the stages of every entry: the pipeline layout declares
+     *  a single range covering all of them (see _getPipelinePushConstantRanges),
+     *  as no two ranges may include the same stage.
+     */
+    std::vector<VkPushConstantRange> _getPushConstantRanges(VulkanApplication *app);
+
+    /**
+     * Get the push constant ranges of the pipeline layout, none or one.
+     */
+    std::vector<VkPushConstantRange> _getPipelinePushConstantRanges(VulkanApplication *app);
 };
 
 class Shader
@@ -61,10 +115,35 @@ private:
 
     VkPipeline graphicsPipeline;
     VkPipelineLayout graphicsPipelineLayout;
+
+    // Set once graphicsPipeline can be bound
+    std::atomic<bool> pipelineReady;
+    std::future<void> pipelineCompilation;
+
+    // Used for draws while the pipeline is still compiling
+    Shader *fallbackShader;
     VkDescriptorSetLayout descriptorSetLayout;
 
+    // Placeholder for set 0 when a bindless shader has no uniforms
+    VkDescriptorSetLayout emptyDescriptorSetLayout;
+
     ShaderLayout shaderLayout;
 
+    // Push constant ranges, matching the order of shaderLayout.pushConstantsLayout
+    std::vector<VkPushConstantRange> pushConstantRanges;
+
+    // Aligned copy of the largest padded push constant entry, reused every draw
+    std::vector<char> pushConstantScratch;
+
+    // Uniform lookup tables, precomputed from shaderLayout.uniformsLayout
+    std::unordered_map<std::string, int> uniformIndices;
+    std::vector<VkDescriptorType> uniformDescriptorTypes;
+    std::vector<uint32_t> dynamicUniformStrides;
+
+    // Writes every uniform from an array of UniformDescriptorInfo in one call,
+    //  VK_NULL_HANDLE when the device doesn't support Vulkan 1.1
+    VkDescriptorUpdateTemplate descriptorUpdateTemplate;
+
     int shaderFlags;
 
     // Cached shader modules for window resize optimisation
@@ -75,9 +154,20 @@ private:
 
     VkShaderModule createShaderModule(std::vector<char> source);
 
+    void createUniformLookupTables();
+    void createDescriptorUpdateTemplate();
+
+    // Descriptor set layouts, update template and pipeline layout live as
+    //  long as the shader, independent of the swapchain
+    void createPipelineLayout();
+    void destroyPipelineLayout();
+
     void createGraphicsPipeline();
     void destroyGraphicsPipeline();
 
+    // Create the pipeline now, or on a worker thread with ASYNC_COMPILE
+    void compileGraphicsPipeline();
+
 public:
     static Shader *loadFromSPIRV(VulkanApplication *app, ShaderLayout shaderLayout,
                                  const char *vertPath, const char *fragPath, int shaderFlags = 0);
@@ -86,11 +176,115 @@ public:
            std::vector<char> fragSource, int shaderFlags = 0);
     ~Shader();
 
+    static VkShaderStageFlags _getVkShaderStageFlags(uint32_t stage);
+
+    /**
+     * Check whether the shader's pipeline has finished compiling.
+     */
+    bool isReady();
+
+    /**
+     * Block until the shader's pipeline has finished compiling.
+     *
+     * Rethrows the error if compilation failed on the worker thread.
+     */
+    void waitUntilReady();
+
+    /**
+     * Set a shader to draw with while this shader's pipeline is compiling.
+     *
+     * The fallback must be created with the same ShaderLayout (and bindless
+     *  flag) so that materials of this shader can be bound with it, e.g. a
+     *  cheap placeholder shader compiled synchronously.
+     *
+     * @param fallbackShader shader to draw with, or nullptr to skip draws
+     *  until this shader is ready
+     */
+    void setFallbackShader(Shader *fallbackShader);
+    Shader *getFallbackShader();
+
+    /**
+     * Wait for any pending compilation without rethrowing its errors.
+     */
+    void _waitForPipeline();
+
     VkPipeline _getGraphicsPipeline();
     VkPipelineLayout _getGraphicsPipelineLayout();
     VkDescriptorSet _getNewDescriptorSet();
+
+    /**
+     * Return a descriptor set created by _getNewDescriptorSet for reuse.
+     *
+     * @param descriptorSet descriptor set to release
+     */
+    void _releaseDescriptorSet(VkDescriptorSet descriptorSet);
+
+    /**
+     * Get a descriptor set that is only valid until the current frame is
+     *  rendered again.
+     *
+     * @returns transient descriptor set, or VK_NULL_HANDLE if the shader has no
+     *  uniforms
+     */
+    VkDescriptorSet _getTransientDescriptorSet();
+
+    /**
+     * Rebuild the graphics pipeline, e.g. after the render pass has changed.
+     *  Descriptor sets allocated from the shader remain valid.
+     */
     void _recreateGraphicsPipeline();
 
+    /**
+     * Check whether the shader indexes the global bindless texture array.
+     */
+    bool _usesBindlessTextures();
+
+    /**
+     * Find the index of a uniform in the shader's layout.
+     *
+     * @param uniformName name of the uniform
+     * @returns the index of the uniform or '-1' if there is no uniform with
+     *  the given name
+     */
+    int _getUniformIndex(const std::string &uniformName);
+
+    /**
+     * Get the descriptor type of the uniform at the given index.
+     */
+    VkDescriptorType _getUniformDescriptorType(int uniformIndex);
+
+    /**
+     * Get the binding of the uniform at the given index.
+     */
+    uint32_t _getUniformBinding(int uniformIndex);
+
+    /**
+     * Get the total number of uniforms declared by the shader.
+     */
+    uint32_t _getUniformCount();
+
+    /**
+     * Get the aligned strides of the shader's dynamic uniforms.
+     */
+    const std::vector<uint32_t> &_getDynamicUniformStrides();
+
+    /**
+     * Get the descriptor update template of the shader.
+     *
+     * @returns template taking one UniformDescriptorInfo per uniform, or
+     *  VK_NULL_HANDLE if templates aren't supported
+     */
+    VkDescriptorUpdateTemplate _getDescriptorUpdateTemplate();
+
+    /**
+     * Record the shader's push constants into the given command buffer.
+     *
+     * @param commandBuffer command buffer to record into
+     * @param data unaligned data for every push constant entry, in declaration
+     *  order
+     */
+    void _pushConstants(VkCommandBuffer commandBuffer, void *data);
+
     ShaderLayout getShaderLayout();
 };
 } // namespace Shade
\ No newline at end of file
@@ -64,6 +64,8 @@ public:
     uint32_t getUnalignedStride();
 
     void *alignData(VulkanApplication *app, void *data, uint32_t count, BufferUsage bufferUsage);
+    void alignDataInto(VulkanApplication *app, void *data, uint32_t count,
+                       BufferUsage bufferUsage, void *alignedData);
     uint32_t getLargestBufferVariableAlignment();
     std::vector<VkVertexInputAttributeDescription> _getAttributeDescriptions();
 
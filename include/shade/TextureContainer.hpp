@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+
+#include "./MappedFile.hpp"
+#include "./UniformTexture.hpp"
+
+namespace Shade
+{
+/**
+ * Memory mapped KTX2 or DDS texture with pre-built mip levels, e.g. in a
+ *  block-compressed format.
+ *
+ * Only single 2D images are supported (no arrays, cube maps or volumes), and
+ *  KTX2 files must not be supercompressed.
+ */
+class TextureContainer
+{
+private:
+    MappedFile file;
+    UniformTextureMipData mipData;
+
+    void readKTX2(std::string path);
+    void readDDS(std::string path);
+
+public:
+    /**
+     * Class constructor, the container type is detected from the file's
+     *  contents. Throws if the file can't be read.
+     *
+     * @param path path of the .ktx2 or .dds file
+     */
+    TextureContainer(std::string path);
+
+    /**
+     * Get the mip levels, pointing into the mapped file (only valid for the
+     *  lifetime of the container).
+     */
+    const UniformTextureMipData &getMipData();
+};
+} // namespace Shade
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+class ThreadPool;
+
+enum TextureEncoderQuality
+{
+    TEXTURE_ENCODER_QUALITY_FAST,   // Bounding box endpoints, no refinement
+    TEXTURE_ENCODER_QUALITY_NORMAL, // Principal axis endpoints, refined once
+    TEXTURE_ENCODER_QUALITY_HIGH    // Repeated refinement and wider endpoint searches
+};
+
+/**
+ * CPU block compression of RGBA8 images into BC1, BC3, BC4, BC5 or BC7, for
+ *  offline texture cooking.
+ *
+ * Blocks are encoded in parallel on a thread pool. BC7 only uses mode 6 (a
+ *  single subset with RGBA endpoints), which suits most colour textures and
+ *  keeps encoding fast; partitioned modes are not searched.
+ */
+class TextureEncoder
+{
+private:
+    ThreadPool *threadPool;
+    TextureEncoderQuality quality;
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param threadPool pool to encode on, or nullptr to encode on the calling
+     *  thread. Must not be called from a task running on the same pool.
+     * @param quality trade-off between encoding time and quality
+     */
+    TextureEncoder(ThreadPool *threadPool = nullptr,
+                   TextureEncoderQuality quality = TEXTURE_ENCODER_QUALITY_NORMAL);
+
+    /**
+     * Encode an RGBA8 image. BC4 uses the red channel and BC5 the red and
+     *  green channels. sRGB formats encode the stored values unchanged.
+     *
+     * @param pixels tightly packed RGBA8 pixels
+     * @param width width of the image
+     * @param height height of the image
+     * @param format block-compressed format to encode into
+     * @returns the encoded blocks, row by row
+     */
+    std::vector<uint8_t> encode(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                VkFormat format);
+
+    void setQuality(TextureEncoderQuality quality);
+    TextureEncoderQuality getQuality();
+
+    /**
+     * Check whether a format can be produced by the encoder.
+     */
+    static bool isSupportedFormat(VkFormat format);
+};
+} // namespace Shade
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+namespace Shade
+{
+/**
+ * Memory layout of a texture format. Uncompressed formats are described as
+ *  1x1 blocks.
+ */
+struct TextureFormatInfo
+{
+    uint32_t blockWidth = 1;
+    uint32_t blockHeight = 1;
+    uint32_t blockSize = 0; // Bytes per block, 0 if the format isn't supported by Shade
+
+    uint32_t channels = 0;      // Number of colour/alpha channels
+    uint32_t channelBits = 0;   // Bits per channel of uncompressed formats, 0 if packed
+    bool floatingPoint = false; // Channels are floats rather than normalised integers
+};
+
+class TextureFormat
+{
+public:
+    /**
+     * Get the block dimensions and size of a format.
+     */
+    static TextureFormatInfo getInfo(VkFormat format);
+
+    /**
+     * Check whether a format is block-compressed (BC1 to BC7), requiring the
+     *  textureCompressionBC device feature.
+     */
+    static bool isBlockCompressed(VkFormat format);
+
+    /**
+     * Check whether a format stores colour in sRGB, converted to linear when
+     *  sampled.
+     */
+    static bool isSRGB(VkFormat format);
+
+    /**
+     * Get the uncompressed format with a number of channels and bits per
+     *  channel: 8-bit UNORM, 16-bit UNORM or 32-bit SFLOAT.
+     *
+     * @returns the format, or VK_FORMAT_UNDEFINED if there is none
+     */
+    static VkFormat getUncompressedFormat(uint32_t channels, uint32_t channelBits);
+
+    /**
+     * Check whether pixels of a format can be converted with decodePixels and
+     *  encodePixels, true for every uncompressed format Shade supports.
+     */
+    static bool isConvertible(VkFormat format);
+
+    /**
+     * Convert pixels to RGBA floats. Missing channels are 0 and a missing alpha
+     *  is 1; sRGB values are returned as stored, without linearisation.
+     *
+     * @param format format of the pixels, must be convertible
+     * @param pixels tightly packed pixels to read
+     * @param pixelCount number of pixels to convert
+     * @param rgba destination of 4 floats per pixel
+     */
+    static void decodePixels(VkFormat format, const void *pixels, size_t pixelCount, float *rgba);
+
+    /**
+     * Convert RGBA floats to pixels of a format, the inverse of decodePixels.
+     *  Values are clamped to the range of the format and rounded to nearest.
+     */
+    static void encodePixels(VkFormat format, const float *rgba, size_t pixelCount, void *pixels);
+
+    /**
+     * Get the size in bytes of a tightly packed image of a format.
+     */
+    static VkDeviceSize getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+};
+} // namespace Shade
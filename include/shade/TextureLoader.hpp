@@ -0,0 +1,133 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "./UniformTexture.hpp"
+#include "./VulkanApplication.hpp"
+
+namespace Shade
+{
+class UploadBatch;
+
+/**
+ * Loads textures in the background: image files are decoded in parallel on
+ *  the worker thread pool and the decoded pixels are uploaded by the render
+ *  thread, many textures per submission (see UploadBatch).
+ *
+ * Uploads are recorded once per frame by the application, limited to a number
+ *  of bytes per frame so that loading doesn't cause hitches.
+ */
+class TextureLoader
+{
+private:
+    struct Request
+    {
+        std::string path;
+        UniformTextureFilterMode filterMode;
+        bool enableMipmaps;
+        VkFormat format;
+
+        UniformTexturePixelData pixelData = {};
+        std::exception_ptr error; // Set if decoding failed
+
+        std::promise<UniformTexture *> promise;
+    };
+
+    struct InFlightBatch
+    {
+        UploadBatch *batch;
+        std::vector<UniformTexture *> textures;
+        std::vector<std::shared_ptr<Request>> requests;
+    };
+
+    VulkanApplication *app;
+    VulkanApplicationData *vulkanData;
+
+    VkDeviceSize maxBytesPerFrame;
+
+    // Decoded requests waiting for upload and the number still decoding
+    std::vector<std::shared_ptr<Request>> decoded;
+    uint32_t decoding;
+    std::mutex decodedMutex;
+    std::condition_variable decodeFinished;
+
+    std::vector<InFlightBatch> inFlight;
+
+    void decode(std::shared_ptr<Request> request);
+
+    // Upload decoded requests, ignoring the per-frame limit if unlimited
+    void recordUploads(bool unlimited);
+
+    // Deliver the textures of completed batches, waiting for them if wait
+    void completeBatches(bool wait);
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param app application the textures belong to
+     * @param maxBytesPerFrame maximum number of pixel bytes uploaded per frame,
+     *  a larger texture is uploaded on its own
+     */
+    TextureLoader(VulkanApplication *app, VkDeviceSize maxBytesPerFrame);
+
+    /**
+     * Class destructor, waits for outstanding decodes but uploads nothing:
+     *  the futures of loads that haven't completed rethrow on get().
+     */
+    ~TextureLoader();
+
+    /**
+     * Start loading a texture in the background.
+     *
+     * @returns future that becomes ready once the texture is resident on the
+     *  GPU, rethrowing on get() if the image couldn't be loaded. The caller
+     *  owns the texture.
+     */
+    std::shared_future<UniformTexture *>
+    load(std::string path,
+         UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR,
+         bool enableMipmaps = true, VkFormat format = VK_FORMAT_UNDEFINED);
+
+    /**
+     * Start loading many textures in the background, decoded in parallel.
+     *
+     * @returns a future per path, in the same order
+     */
+    std::vector<std::shared_future<UniformTexture *>>
+    loadBatch(const std::vector<std::string> &paths,
+              UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR,
+              bool enableMipmaps = true, VkFormat format = VK_FORMAT_UNDEFINED);
+
+    /**
+     * Upload textures decoded since the last call and deliver those whose
+     *  upload completed. Called once per frame by the application.
+     */
+    void _processUploads();
+
+    /**
+     * Wait until every outstanding load has completed and its future is
+     *  ready.
+     *
+     * Futures only become ready on the render thread, so call this rather
+     *  than waiting on a future from the render thread.
+     */
+    void flush();
+
+    /**
+     * Get the number of textures still decoding or uploading.
+     */
+    uint32_t getPendingCount();
+
+    void setMaxBytesPerFrame(VkDeviceSize maxBytesPerFrame);
+};
+} // namespace Shade
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Shade
+{
+
+/**
+ * Fixed-size pool of worker threads executing queued tasks in FIFO order.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+
+    std::queue<std::function<void()>> tasks;
+    std::mutex tasksMutex;
+    std::condition_variable tasksAvailable;
+
+    bool stopping;
+
+    void workerLoop();
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param threadCount number of worker threads, or '0' to use one less than
+     *  the number of hardware threads (leaving a core for the main thread)
+     */
+    ThreadPool(uint32_t threadCount = 0);
+
+    /**
+     * Class destructor
+     *
+     * Finishes every queued task before joining the worker threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * Queue a task for execution on a worker thread.
+     *
+     * @param task function to execute
+     * @returns future that becomes ready once the task has run, rethrowing any
+     *  exception thrown by the task on get()
+     */
+    std::future<void> enqueue(std::function<void()> task);
+
+    /**
+     * Get the number of worker threads.
+     */
+    uint32_t getThreadCount();
+};
+} // namespace Shade
@@ -4,11 +4,14 @@
 
 #include <vulkan/vulkan.h>
 
+#include <future>
 #include <string>
 #include <vector>
 
 namespace Shade
 {
+class UploadBatch;
+
 class UniformTextureLayout
 {
 private:
@@ -24,6 +27,29 @@ struct UniformTexturePixelData
 	int height;
 	int channels;
 	int bpp; // Bits per pixel
+
+	// Format of the pixels. If undefined it is derived from channels and bpp
+	//  (8-bit UNORM, 16-bit UNORM or 32-bit float channels), or RGBA8 if
+	//  those aren't set either. Derived formats the device can't sample with
+	//  linear filtering are converted to RGBA8 or, above 8 bits, RGBA16F
+	VkFormat format = VK_FORMAT_UNDEFINED;
+
+	// One (grey) or two (grey and alpha) channel pixels, sampled as RRR1 or
+	//  RRRG so that they read like the RGBA pixels they used to be loaded as
+	bool greyscale = false;
+};
+
+// Mip levels ready to be copied to the GPU (see vkCmdCopyBufferToImage), in a
+//  single block of memory
+struct UniformTextureMipData
+{
+	VkFormat format;
+	uint32_t width;  // Width of the largest level
+	uint32_t height; // Height of the largest level
+	const void *data;
+	VkDeviceSize size; // Total size of data
+	std::vector<VkDeviceSize> levelOffsets; // Offset of every level in data, largest first
+	VkComponentMapping components = {}; // Swizzle of the image view, identity by default
 };
 
 enum UniformTextureFilterMode
@@ -35,21 +61,151 @@ enum UniformTextureFilterMode
 class UniformTexture
 {
 private:
+	VulkanApplication* app;
 	VulkanApplicationData* vulkanData;
 
 	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
+	VmaAllocation textureImageAllocation;
 	VkImageView textureImageView;
 	VkSampler textureSampler;
 
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mipLevels;
+	VkImageUsageFlags usageFlags;
+	VkComponentMapping components;
+
+	// Copy of the texture being made by the defragmenter
+	VkImage relocationImage;
+	VmaAllocation relocationAllocation;
+
+	// Slot in the global bindless texture array, if bindless mode is enabled
+	uint32_t bindlessIndex;
+
+	// Batch the upload was recorded into, until it completes
+	UploadBatch* uploadBatch;
+	bool resident;
+
+	void createTexture(VulkanApplication* app, const UniformTextureMipData& mipData, bool generateMipmaps, UniformTextureFilterMode filterMode, UploadBatch* uploadBatch);
 	void createTextureSampler(UniformTextureFilterMode filterMode, uint32_t mipLevels = 1);
 public:
-	UniformTexture(VulkanApplication* app, UniformTexturePixelData pixelData, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true);
+	/**
+	 * Class constructor
+	 *
+	 * The whole upload (layout transitions, copy and mipmap generation) is
+	 *  recorded into a single command buffer. Without an upload batch it is
+	 *  submitted and waited on immediately, otherwise the texture becomes
+	 *  usable once the batch completes.
+	 *
+	 * @param uploadBatch batch to record the upload into, or nullptr
+	 */
+	UniformTexture(VulkanApplication* app, UniformTexturePixelData pixelData, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true, UploadBatch* uploadBatch = nullptr);
+
+	/**
+	 * Create a texture from pre-built mip levels, copied as they are without
+	 *  generating any further levels.
+	 */
+	UniformTexture(VulkanApplication* app, const UniformTextureMipData& mipData, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, UploadBatch* uploadBatch = nullptr);
 	~UniformTexture();
 
-	static UniformTexture* loadFromPath(VulkanApplication* app, std::string path, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true);
+	/**
+	 * Load a texture from an image file.
+	 *
+	 * @param format format to store the texture in, or VK_FORMAT_UNDEFINED to
+	 *  keep the channels and precision of the image (see _loadPixelData), with
+	 *  greyscale images sampled as (r, r, r, 1) or (r, r, r, g). Requested
+	 *  formats with fewer than 4 channels sample as (r, 0, 0, 1) or
+	 *  (r, g, 0, 1), and must be supported by the device.
+	 */
+	static UniformTexture* loadFromPath(VulkanApplication* app, std::string path, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true, UploadBatch* uploadBatch = nullptr, VkFormat format = VK_FORMAT_UNDEFINED);
+
+	/**
+	 * Load a texture cooked by the texture cooker tool (.stex). The file is
+	 *  memory mapped and its levels copied straight into staging memory, with
+	 *  no decoding or mipmap generation.
+	 */
+	static UniformTexture* loadFromCooked(VulkanApplication* app, std::string path, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, UploadBatch* uploadBatch = nullptr);
+
+	/**
+	 * Load a KTX2 or DDS texture with its pre-built mip levels, e.g. in a
+	 *  block-compressed format (see TextureContainer).
+	 */
+	static UniformTexture* loadFromContainer(VulkanApplication* app, std::string path, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, UploadBatch* uploadBatch = nullptr);
+
+	/**
+	 * Load many textures, decoding the images in parallel on the worker
+	 *  threads and uploading them in a single submission.
+	 *
+	 * @returns the textures in the same order as the paths
+	 */
+	static std::vector<UniformTexture*> loadFromPaths(VulkanApplication* app, const std::vector<std::string>& paths, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true, VkFormat format = VK_FORMAT_UNDEFINED);
+
+	/**
+	 * Load a texture in the background, see TextureLoader::load.
+	 *
+	 * @returns future that becomes ready once the texture is resident
+	 */
+	static std::shared_future<UniformTexture*> loadFromPathAsync(VulkanApplication* app, std::string path, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true, VkFormat format = VK_FORMAT_UNDEFINED);
+	static std::vector<std::shared_future<UniformTexture*>> loadFromPathsAsync(VulkanApplication* app, const std::vector<std::string>& paths, UniformTextureFilterMode filterMode = UniformTextureFilterMode::LINEAR, bool enableMipmaps = true, VkFormat format = VK_FORMAT_UNDEFINED);
+
+	/**
+	 * Decode an image file, safe to call from any thread. The pixels must be
+	 *  released with _freePixelData.
+	 *
+	 * @param format 8-bit, 16-bit UNORM, 16-bit or 32-bit float format with 1,
+	 *  2 or 4 channels, or B10G11R11_UFLOAT, to decode into. If undefined, the
+	 *  image's channels are kept (RGB gains an alpha channel) with 8-bit
+	 *  precision, and HDR images become R16G16B16A16_SFLOAT. 16-bit PNGs
+	 *  become R16G16B16A16_SFLOAT too, unless physicalDevice can filter the
+	 *  16-bit UNORM format with their channels.
+	 * @param physicalDevice device the texture is created on, or
+	 *  VK_NULL_HANDLE if unknown
+	 */
+	static UniformTexturePixelData _loadPixelData(std::string path, VkFormat format = VK_FORMAT_UNDEFINED, VkPhysicalDevice physicalDevice = VK_NULL_HANDLE);
+	static void _freePixelData(UniformTexturePixelData& pixelData);
+
+	/**
+	 * Check whether the texture's upload has completed and it may be used
+	 *  for rendering.
+	 */
+	bool isResident();
+
+	/**
+	 * Called by the upload batch once the texture's upload has completed.
+	 */
+	void _markResident();
 
 	VkImageView _getTextureImageView();
 	VkSampler _getTextureSampler();
+
+	/**
+	 * Get the index of the texture in the global bindless texture array, to be
+	 *  passed to bindless shaders (usually through a push constant).
+	 *
+	 * Only valid when bindless textures are enabled in ShadeApplicationInfo.
+	 */
+	uint32_t getBindlessIndex();
+
+	/**
+	 * Get the size of the texture's device memory allocation in bytes.
+	 */
+	VkDeviceSize _getAllocationSize();
+
+	/**
+	 * Try to move the texture into another memory block: if VMA can place a
+	 *  copy in an existing block other than the current one, record the copy
+	 *  into the command buffer.
+	 *
+	 * @param commandBuffer command buffer to record the copy into, must be
+	 *  submitted and completed before _finishRelocation
+	 * @returns true if a copy was recorded
+	 */
+	bool _beginRelocation(VkCommandBuffer commandBuffer);
+
+	/**
+	 * Switch to the copy made by _beginRelocation and release the old image.
+	 */
+	void _finishRelocation();
 };
 }
\ No newline at end of file
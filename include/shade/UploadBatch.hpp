@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "./VulkanApplication.hpp"
+
+namespace Shade
+{
+class Buffer;
+class UniformTexture;
+
+/**
+ * Records the uploads of many textures into a single command buffer, which
+ *  is submitted once and signals a single fence.
+ *
+ * Pass the batch to UniformTexture::loadFromPath or the UniformTexture
+ *  constructor, then submit it. The textures may not be used for rendering
+ *  until the batch has completed (see isComplete and wait).
+ */
+class UploadBatch
+{
+private:
+    VulkanApplication *app;
+    VulkanApplicationData *vulkanData;
+
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+
+    // Released once the GPU has finished copying from them
+    std::vector<Buffer *> stagingBuffers;
+
+    std::vector<UniformTexture *> textures;
+
+    bool submitted;
+    bool completed;
+
+    void finish();
+
+public:
+    /**
+     * Class constructor
+     *
+     * @param app application the uploaded resources belong to
+     */
+    UploadBatch(VulkanApplication *app);
+
+    /**
+     * Class destructor, submits the batch if required and waits for it to
+     *  complete.
+     */
+    ~UploadBatch();
+
+    /**
+     * Get the command buffer uploads are recorded into.
+     */
+    VkCommandBuffer _getCommandBuffer();
+
+    /**
+     * Take ownership of a staging buffer, it is deleted when the batch
+     *  completes.
+     */
+    void _addStagingBuffer(Buffer *buffer);
+
+    /**
+     * Add a texture whose upload was recorded into the batch, it is made
+     *  resident when the batch completes.
+     */
+    void _addTexture(UniformTexture *texture);
+
+    /**
+     * Submit the recorded uploads to the graphics queue without waiting.
+     *  Nothing more may be recorded into the batch afterwards.
+     */
+    void submit();
+
+    /**
+     * Check whether the GPU has finished the uploads, releasing the staging
+     *  buffers if it has.
+     */
+    bool isComplete();
+
+    /**
+     * Wait for the uploads to complete, submitting the batch if required.
+     */
+    void wait();
+
+    bool isSubmitted();
+};
+} // namespace Shade
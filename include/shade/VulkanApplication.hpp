@@ -9,15 +9,25 @@
 #include <vector>
 #include <vulkan/vulkan.h>
 #include "./vendor/vk_mem_alloc.hpp"
+#include "./MemoryStatistics.hpp"
 
 namespace Shade
 {
     // Forward declaration of shader
     class Shader;
+    class DescriptorAllocator;
+    class BindlessTextureRegistry;
+    class PipelineCache;
+    class ThreadPool;
+    struct AtomicRenderCounters;
+    class Defragmenter;
+    class TextureLoader;
+    class MipDownsampler;
 
     struct VulkanApplicationData
     {
         VkInstance instance;
+        uint32_t apiVersion; // Vulkan API version used by the instance and device
         VkPhysicalDevice physicalDevice;
         VkPhysicalDeviceProperties physicalDeviceProperties;
         VkDevice device;
@@ -43,21 +53,62 @@ namespace Shade
         VkCommandPool commandPool;
         std::vector<VkCommandBuffer> commandBuffers;
 
-        VkSemaphore imageAvailableSemaphore;
-        VkSemaphore renderFinishedSemaphore;
+        // Synchronisation objects, one of each per frame in flight
+        std::vector<VkSemaphore> imageAvailableSemaphores;
+        std::vector<VkSemaphore> renderFinishedSemaphores;
+        std::vector<VkFence> inFlightFences;
 
-        VkDescriptorPool descriptorPool;
+        // Fence of the frame that last rendered to each swapchain image
+        std::vector<VkFence> imagesInFlight;
+
+        // Frame in flight currently being recorded
+        uint32_t currentFrame;
+
+        DescriptorAllocator *descriptorAllocator;
+
+        // Global texture array, nullptr unless bindless textures are enabled
+        BindlessTextureRegistry *bindlessTextures;
+
+        // Pipeline cache shared by all shaders
+        PipelineCache *pipelineCache;
+
+        // Worker threads for background work such as pipeline compilation
+        ThreadPool *threadPool;
+
+        // Decodes and uploads textures in the background
+        TextureLoader *textureLoader;
+
+        // Work counters of the current frame, incremented by Shade objects
+        AtomicRenderCounters *renderCounters;
 
         // Current image being rendered to
         uint32_t currentImageIndex;
 
         VkImage depthImage;
-        VkDeviceMemory depthImageMemory;
+        VmaAllocation depthImageAllocation;
         VkImageView depthImageView;
         VkFormat depthImageFormat;
 
         VmaAllocator allocator;
         const VkAllocationCallbacks *allocationCallbacks;
+
+        // Allocation tracking and budget warnings
+        MemoryStatistics *memoryStatistics;
+        bool memoryBudgetSupported; // VK_EXT_memory_budget is enabled
+
+        // BC1 to BC7 block-compressed textures can be sampled
+        bool textureCompressionBC;
+
+        // Storage images can be written without a format qualifier, required
+        //  by compute mip generation
+        bool storageImageWriteWithoutFormat;
+
+        // Compute mip generation, nullptr if unsupported
+        MipDownsampler *mipDownsampler;
+
+        // Relocates buffers and textures to reduce fragmentation, nullptr
+        //  unless defragmentation is enabled
+        Defragmenter *defragmenter;
     };
 
     class VulkanApplication
@@ -87,25 +138,39 @@ namespace Shade
         // Various utility functions
         uint32_t _findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
+        static VkImageCreateInfo _getImageCreateInfo(uint32_t width, uint32_t height,
+                                                     VkFormat format, VkImageTiling tiling,
+                                                     VkImageUsageFlags usage,
+                                                     uint32_t mipLevels = 1);
+
         void _createImage(uint32_t width, uint32_t height,
                           VkFormat format, VkImageTiling tiling,
                           VkImageUsageFlags usage,
                           VkMemoryPropertyFlags properties,
-                          VkImage &image, VkDeviceMemory &imageMemory,
-                          uint32_t mipLevels = 1);
+                          VkImage &image, VmaAllocation &imageAllocation,
+                          uint32_t mipLevels = 1,
+                          MemoryCategory category = MEMORY_CATEGORY_TEXTURE);
+        void _destroyImage(VkImage image, VmaAllocation imageAllocation,
+                           MemoryCategory category = MEMORY_CATEGORY_TEXTURE);
 
         void _createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView &imageView,
-                              uint32_t mipLevels = 1);
+                              uint32_t mipLevels = 1, VkComponentMapping components = {});
 
-        void _generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels);
+        // The following record into commandBuffer when one is given, otherwise
+        //  they submit single time commands and wait for them to complete
+        void _generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+                              VkCommandBuffer commandBuffer = VK_NULL_HANDLE);
 
         VkCommandBuffer _beginSingleTimeCommands();
         void _endSingleTimeCommands(VkCommandBuffer commandBuffer);
         void _copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-        void _copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+        void _copyBufferToImage(VkBuffer buffer, VkImage image,
+                                const std::vector<VkBufferImageCopy> &regions,
+                                VkCommandBuffer commandBuffer = VK_NULL_HANDLE);
         void _transitionImageLayout(VkImage image, VkFormat format,
                                     VkImageLayout oldLayout,
                                     VkImageLayout newLayout,
-                                    uint32_t mipLevels = 1);
+                                    uint32_t mipLevels = 1,
+                                    VkCommandBuffer commandBuffer = VK_NULL_HANDLE);
     };
 } // namespace Shade
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "shade/BindlessTextureRegistry.hpp"
+
+#include <stdexcept>
+
+using namespace Shade;
+
+// Bit mask of every frame, a bit is cleared when the frame begins again
+static uint64_t getFrameMask(uint32_t frameCount)
+{
+    if (frameCount > 64)
+    {
+        throw std::runtime_error("Shade: Too many frames for bindless texture slot reuse!");
+    }
+
+    return frameCount == 64 ? ~0ull : (1ull << frameCount) - 1;
+}
+
+BindlessTextureRegistry::BindlessTextureRegistry(VkDevice device, uint32_t capacity,
+                                                 uint32_t frameCount)
+{
+    this->device = device;
+    this->capacity = capacity;
+    this->frameCount = frameCount;
+
+    // Fails early rather than on the first unregistered texture
+    getFrameMask(frameCount);
+
+    nextIndex = 0;
+
+    createDescriptorSetLayout();
+    createDescriptorSet();
+}
+
+BindlessTextureRegistry::~BindlessTextureRegistry()
+{
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+void BindlessTextureRegistry::createDescriptorSetLayout()
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = capacity;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    binding.pImmutableSamplers = nullptr;
+
+    // Unused slots may stay empty, and slots may be written after the set is
+    //  bound, even while submitted frames that don't sample them are executing
+    VkDescriptorBindingFlagsEXT bindingFlags =
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+        VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.pNext = nullptr;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) !=
+        VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create bindless texture descriptor set layout!");
+    }
+}
+
+void BindlessTextureRegistry::createDescriptorSet()
+{
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity};
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create bindless texture descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to allocate bindless texture descriptor set!");
+    }
+}
+
+uint32_t BindlessTextureRegistry::registerTexture(VkImageView imageView, VkSampler sampler)
+{
+    uint32_t index;
+
+    if (!freeIndices.empty())
+    {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+    }
+    else if (nextIndex < capacity)
+    {
+        index = nextIndex++;
+    }
+    else
+    {
+        throw std::runtime_error("Shade: Bindless texture array is full!");
+    }
+
+    updateTexture(index, imageView, sampler);
+
+    return index;
+}
+
+void BindlessTextureRegistry::updateTexture(uint32_t index, VkImageView imageView,
+                                            VkSampler sampler)
+{
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = imageView;
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = nullptr;
+    descriptorWrite.pImageInfo = &imageInfo;
+    descriptorWrite.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+void BindlessTextureRegistry::unregisterTexture(uint32_t index)
+{
+    retiringIndices.push_back({index, getFrameMask(frameCount)});
+}
+
+void BindlessTextureRegistry::beginFrame(uint32_t frameIndex)
+{
+    for (size_t i = 0; i < retiringIndices.size();)
+    {
+        RetiringIndex &retiring = retiringIndices[i];
+        retiring.pendingFrames &= ~(1ull << frameIndex);
+
+        if (retiring.pendingFrames != 0)
+        {
+            i++;
+            continue;
+        }
+
+        freeIndices.push_back(retiring.index);
+        retiring = retiringIndices.back();
+        retiringIndices.pop_back();
+    }
+}
+
+void BindlessTextureRegistry::setFrameCount(uint32_t frameCount)
+{
+    getFrameMask(frameCount);
+    this->frameCount = frameCount;
+
+    for (const RetiringIndex &retiring : retiringIndices)
+    {
+        freeIndices.push_back(retiring.index);
+    }
+    retiringIndices.clear();
+}
+
+uint32_t BindlessTextureRegistry::getCapacity() { return capacity; }
+
+VkDescriptorSetLayout BindlessTextureRegistry::_getDescriptorSetLayout()
+{
+    return descriptorSetLayout;
+}
+
+VkDescriptorSet BindlessTextureRegistry::_getDescriptorSet() { return descriptorSet; }
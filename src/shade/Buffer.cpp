@@ -2,6 +2,10 @@
 
 #include <iostream>
 
+#include "shade/Defragmenter.hpp"
+#include "shade/Profiler.hpp"
+#include "shade/RenderCounters.hpp"
+
 using namespace Shade;
 
 /**
@@ -166,6 +170,8 @@ void *Buffer::getData(uint32_t count, uint32_t offset)
         {
             throw std::runtime_error("Shade: Failed to create staging buffer!");
         }
+        vulkanData->memoryStatistics->_trackAllocation(MEMORY_CATEGORY_STAGING,
+                                                       stagingBufferAllocationInfo.size);
 
         // Copy data from staging buffer to GPU buffer
         VkBufferCopy regions[1];
@@ -185,6 +191,8 @@ void *Buffer::getData(uint32_t count, uint32_t offset)
         vmaUnmapMemory(vulkanData->allocator, stagingBufferAllocation);
 
         // Cleanup staging buffer
+        vulkanData->memoryStatistics->_trackFree(MEMORY_CATEGORY_STAGING,
+                                                 stagingBufferAllocationInfo.size);
         vmaDestroyBuffer(vulkanData->allocator, stagingBuffer, stagingBufferAllocation);
     }
     else if (bufferStorage == GPU_WRITE_ONLY)
@@ -220,7 +228,7 @@ uint32_t Buffer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags prope
     throw std::runtime_error("Shade: Failed to find suitable memory type!");
 }
 
-void Buffer::createBuffer(void *data)
+VkBufferCreateInfo Buffer::getBufferCreateInfo()
 {
     VkBufferCreateInfo bufferInfo = {};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -244,6 +252,10 @@ void Buffer::createBuffer(void *data)
     {
         bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
     }
+    else if (bufferUsage == STORAGE)
+    {
+        bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    }
 
     if ((bufferStorage == GPU) || (bufferStorage == GPU_WRITE_ONLY))
     {
@@ -259,6 +271,13 @@ void Buffer::createBuffer(void *data)
 
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+    return bufferInfo;
+}
+
+void Buffer::createBuffer(void *data)
+{
+    VkBufferCreateInfo bufferInfo = getBufferCreateInfo();
+
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage =
         (bufferStorage == GPU) ? VMA_MEMORY_USAGE_GPU_ONLY : VMA_MEMORY_USAGE_CPU_ONLY;
@@ -268,6 +287,14 @@ void Buffer::createBuffer(void *data)
     {
         throw std::runtime_error("Shade: Failed to create buffer!");
     }
+    vulkanData->memoryStatistics->_trackAllocation(getMemoryCategory(), allocationInfo.size);
+
+    // Staging buffers are only read by upload commands the defragmenter can't
+    //  wait for (such as those of an UploadBatch), and are short lived anyway
+    if (vulkanData->defragmenter != nullptr && bufferUsage != TRANSFER)
+    {
+        vulkanData->defragmenter->_registerBuffer(this);
+    }
 
     if (data != nullptr)
     {
@@ -278,9 +305,14 @@ void Buffer::createBuffer(void *data)
 
 void Buffer::fillBuffer(void *data, uint32_t count, uint32_t offset)
 {
+    SHADE_PROFILE_ZONE("Buffer::fillBuffer");
+
     // Total size of data that will be modified
     int dataSize = count * stride;
 
+    AtomicRenderCounters::add(vulkanData->renderCounters->bufferUploads);
+    AtomicRenderCounters::add(vulkanData->renderCounters->bytesUploaded, dataSize);
+
     if (bufferStorage == CPU)
     {
         // Copy directly to buffer
@@ -314,12 +346,15 @@ void Buffer::fillBuffer(void *data, uint32_t count, uint32_t offset)
         {
             throw std::runtime_error("Shade: Failed to create staging buffer!");
         }
+        vulkanData->memoryStatistics->_trackAllocation(MEMORY_CATEGORY_STAGING,
+                                                       stagingBufferAllocationInfo.size);
 
         // Fill staging buffer
         void *mappedData;
         vmaMapMemory(vulkanData->allocator, stagingBufferAllocation, &mappedData);
         memcpy(mappedData, data, dataSize);
         vmaUnmapMemory(vulkanData->allocator, stagingBufferAllocation);
+        AtomicRenderCounters::add(vulkanData->renderCounters->bytesStaged, dataSize);
 
         // Copy data from staging buffer to GPU buffer
         VkBufferCopy regions[1];
@@ -332,8 +367,55 @@ void Buffer::fillBuffer(void *data, uint32_t count, uint32_t offset)
         app->_endSingleTimeCommands(commandBuffer);
 
         // Cleanup staging buffer
+        vulkanData->memoryStatistics->_trackFree(MEMORY_CATEGORY_STAGING,
+                                                 stagingBufferAllocationInfo.size);
         vmaDestroyBuffer(vulkanData->allocator, stagingBuffer, stagingBufferAllocation);
     }
 }
 
-void Buffer::freeBuffer() { vmaDestroyBuffer(vulkanData->allocator, buffer, allocation); }
+void Buffer::freeBuffer()
+{
+    if (vulkanData->defragmenter != nullptr && bufferUsage != TRANSFER)
+    {
+        vulkanData->defragmenter->_unregisterBuffer(this);
+    }
+
+    vulkanData->memoryStatistics->_trackFree(getMemoryCategory(), allocationInfo.size);
+    vmaDestroyBuffer(vulkanData->allocator, buffer, allocation);
+}
+
+VmaAllocation Buffer::_getAllocation() { return allocation; }
+
+void Buffer::_rebindMemory()
+{
+    // A buffer can't be rebound, create it again at the allocation's new place
+    vkDestroyBuffer(vulkanData->device, buffer, nullptr);
+
+    VkBufferCreateInfo bufferInfo = getBufferCreateInfo();
+    if (vkCreateBuffer(vulkanData->device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to recreate moved buffer!");
+    }
+
+    // Queried to keep the validation layers content, the allocation already fits
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(vulkanData->device, buffer, &memRequirements);
+
+    vmaBindBufferMemory(vulkanData->allocator, allocation, buffer);
+    vmaGetAllocationInfo(vulkanData->allocator, allocation, &allocationInfo);
+}
+
+MemoryCategory Buffer::getMemoryCategory()
+{
+    switch (bufferUsage)
+    {
+    case VERTEX:
+        return MEMORY_CATEGORY_VERTEX;
+    case INDEX:
+        return MEMORY_CATEGORY_INDEX;
+    case TRANSFER:
+        return MEMORY_CATEGORY_STAGING;
+    default:
+        return MEMORY_CATEGORY_UNIFORM;
+    }
+}
@@ -0,0 +1,123 @@
+#include "shade/CookedTexture.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "shade/MipGenerator.hpp"
+#include "shade/TextureFormat.hpp"
+
+using namespace Shade;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+    return (offset + COOKED_TEXTURE_ALIGNMENT - 1) / COOKED_TEXTURE_ALIGNMENT *
+           COOKED_TEXTURE_ALIGNMENT;
+}
+
+CookedTexture::CookedTexture(std::string path) : file(path)
+{
+    const uint8_t *data = file.getData();
+    size_t size = file.getSize();
+
+    header = reinterpret_cast<const CookedTextureHeader *>(data);
+    if (size < sizeof(CookedTextureHeader) || header->magic != COOKED_TEXTURE_MAGIC)
+    {
+        throw std::runtime_error("Shade: '" + path + "' is not a cooked texture!");
+    }
+
+    if (header->version != COOKED_TEXTURE_VERSION)
+    {
+        throw std::runtime_error("Shade: Cooked texture '" + path +
+                                 "' was written by an unsupported version, cook it again!");
+    }
+
+    levels = reinterpret_cast<const CookedTextureLevel *>(data + sizeof(CookedTextureHeader));
+
+    VkFormat format = static_cast<VkFormat>(header->format);
+
+    // The level count bounds every shift below, and data of each level must
+    //  cover its whole size for the upload's copy. Levels follow each other,
+    //  as written, since the upload copies them as one block
+    bool valid = TextureFormat::getInfo(format).blockSize != 0 && header->width > 0 &&
+                 header->height > 0 && header->mipLevels > 0 &&
+                 header->mipLevels <= MipGenerator::getMipLevelCount(header->width,
+                                                                     header->height) &&
+                 sizeof(CookedTextureHeader) + header->mipLevels * sizeof(CookedTextureLevel) <=
+                     size;
+
+    for (uint32_t i = 0; valid && i < header->mipLevels; i++)
+    {
+        uint32_t levelWidth = std::max(header->width >> i, 1u);
+        uint32_t levelHeight = std::max(header->height >> i, 1u);
+
+        valid = levels[i].offset % COOKED_TEXTURE_ALIGNMENT == 0 &&
+                levels[i].offset <= size && levels[i].size <= size - levels[i].offset &&
+                levels[i].size >= TextureFormat::getLevelSize(format, levelWidth, levelHeight) &&
+                levels[i].width == levelWidth && levels[i].height == levelHeight &&
+                (i == 0 || levels[i].offset >= levels[i - 1].offset + levels[i - 1].size);
+    }
+
+    if (!valid)
+    {
+        throw std::runtime_error("Shade: Cooked texture '" + path + "' is corrupt!");
+    }
+}
+
+const CookedTextureHeader &CookedTexture::getHeader() { return *header; }
+
+const CookedTextureLevel &CookedTexture::getLevel(uint32_t level) { return levels[level]; }
+
+const uint8_t *CookedTexture::getLevelData(uint32_t level)
+{
+    return file.getData() + levels[level].offset;
+}
+
+void CookedTexture::write(std::string path, VkFormat format, uint32_t width, uint32_t height,
+                          const std::vector<std::vector<uint8_t>> &levels)
+{
+    CookedTextureHeader header = {};
+    header.magic = COOKED_TEXTURE_MAGIC;
+    header.version = COOKED_TEXTURE_VERSION;
+    header.format = static_cast<uint32_t>(format);
+    header.width = width;
+    header.height = height;
+    header.mipLevels = static_cast<uint32_t>(levels.size());
+
+    std::vector<CookedTextureLevel> levelTable(levels.size());
+    uint64_t offset =
+        alignOffset(sizeof(CookedTextureHeader) + levels.size() * sizeof(CookedTextureLevel));
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        levelTable[i].offset = offset;
+        levelTable[i].size = levels[i].size();
+        levelTable[i].width = std::max(width >> i, 1u);
+        levelTable[i].height = std::max(height >> i, 1u);
+
+        offset = alignOffset(offset + levels[i].size());
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream)
+    {
+        throw std::runtime_error("Shade: Failed to write cooked texture '" + path + "'!");
+    }
+
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char *>(levelTable.data()),
+                 levelTable.size() * sizeof(CookedTextureLevel));
+
+    const char padding[COOKED_TEXTURE_ALIGNMENT] = {};
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        uint64_t position = static_cast<uint64_t>(stream.tellp());
+        stream.write(padding, levelTable[i].offset - position);
+        stream.write(reinterpret_cast<const char *>(levels[i].data()), levels[i].size());
+    }
+
+    if (!stream)
+    {
+        throw std::runtime_error("Shade: Failed to write cooked texture '" + path + "'!");
+    }
+}
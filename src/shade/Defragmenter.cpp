@@ -0,0 +1,227 @@
+#include "shade/Defragmenter.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "shade/Buffer.hpp"
+#include "shade/Profiler.hpp"
+#include "shade/UniformTexture.hpp"
+
+using namespace Shade;
+
+template <typename T> static void removeFromList(std::vector<T *> &list, T *item)
+{
+    auto it = std::find(list.begin(), list.end(), item);
+    if (it != list.end())
+    {
+        // Order doesn't matter, swap with the last element
+        *it = list.back();
+        list.pop_back();
+    }
+}
+
+Defragmenter::Defragmenter(VulkanApplication *app, VkDeviceSize maxBytesPerPass,
+                           uint32_t maxMovesPerPass)
+{
+    this->app = app;
+    this->vulkanData = app->_getVulkanData();
+    this->maxBytesPerPass = maxBytesPerPass;
+    this->maxMovesPerPass = maxMovesPerPass;
+
+    nextTexture = 0;
+    generation = 0;
+}
+
+void Defragmenter::_registerBuffer(Buffer *buffer) { buffers.push_back(buffer); }
+
+void Defragmenter::_unregisterBuffer(Buffer *buffer) { removeFromList(buffers, buffer); }
+
+void Defragmenter::_registerTexture(UniformTexture *texture) { textures.push_back(texture); }
+
+void Defragmenter::_unregisterTexture(UniformTexture *texture)
+{
+    removeFromList(textures, texture);
+}
+
+bool Defragmenter::areFramesInFlight()
+{
+    for (VkFence fence : vulkanData->inFlightFences)
+    {
+        if (vkGetFenceStatus(vulkanData->device, fence) != VK_SUCCESS)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Defragmenter::waitForFramesInFlight()
+{
+    vkWaitForFences(vulkanData->device, static_cast<uint32_t>(vulkanData->inFlightFences.size()),
+                    vulkanData->inFlightFences.data(), VK_TRUE, UINT64_MAX);
+}
+
+VmaDefragmentationContext Defragmenter::beginBufferMoves(VkCommandBuffer commandBuffer,
+                                                         VkDeviceSize &bytesLeft,
+                                                         uint32_t &movesLeft,
+                                                         std::vector<VkBool32> &allocationsChanged,
+                                                         uint64_t &moved)
+{
+    allocationsChanged.assign(buffers.size(), VK_FALSE);
+
+    if (buffers.empty() || movesLeft == 0)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    std::vector<VmaAllocation> allocations(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        allocations[i] = buffers[i]->_getAllocation();
+    }
+
+    // Host visible memory is moved by the CPU, device local memory by copies
+    //  recorded into the command buffer
+    bool gpu = commandBuffer != VK_NULL_HANDLE;
+
+    VmaDefragmentationInfo2 defragmentationInfo = {};
+    defragmentationInfo.allocationCount = static_cast<uint32_t>(allocations.size());
+    defragmentationInfo.pAllocations = allocations.data();
+    defragmentationInfo.pAllocationsChanged = allocationsChanged.data();
+    defragmentationInfo.maxCpuBytesToMove = gpu ? 0 : bytesLeft;
+    defragmentationInfo.maxCpuAllocationsToMove = gpu ? 0 : movesLeft;
+    defragmentationInfo.maxGpuBytesToMove = gpu ? bytesLeft : 0;
+    defragmentationInfo.maxGpuAllocationsToMove = gpu ? movesLeft : 0;
+    defragmentationInfo.commandBuffer = commandBuffer;
+
+    VmaDefragmentationStats defragmentationStats = {};
+    VmaDefragmentationContext context = VK_NULL_HANDLE;
+    if (vmaDefragmentationBegin(vulkanData->allocator, &defragmentationInfo,
+                                &defragmentationStats, &context) < 0)
+    {
+        throw std::runtime_error("Shade: Failed to defragment buffer memory!");
+    }
+
+    bytesLeft -= std::min(bytesLeft, defragmentationStats.bytesMoved);
+    movesLeft -= std::min(movesLeft, defragmentationStats.allocationsMoved);
+    moved += defragmentationStats.allocationsMoved;
+
+    stats.bytesMoved += defragmentationStats.bytesMoved;
+    stats.memoryBlocksFreed += defragmentationStats.deviceMemoryBlocksFreed;
+
+    return context;
+}
+
+void Defragmenter::endBufferMoves(VmaDefragmentationContext context,
+                                  const std::vector<VkBool32> &allocationsChanged)
+{
+    vmaDefragmentationEnd(vulkanData->allocator, context);
+
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        if (allocationsChanged[i])
+        {
+            buffers[i]->_rebindMemory();
+        }
+    }
+}
+
+bool Defragmenter::runPass()
+{
+    SHADE_PROFILE_ZONE("Defragmenter::runPass");
+
+    if (buffers.empty() && textures.empty())
+    {
+        return false;
+    }
+
+    VkDeviceSize bytesLeft = maxBytesPerPass;
+    uint32_t movesLeft = maxMovesPerPass;
+    uint64_t moved = 0;
+
+    // Checked before anything is recorded: CPU moves are only made when no
+    //  frame can be reading the memory they overwrite
+    bool gpuIdle = !areFramesInFlight();
+
+    // Copies only read the resources that frames in flight may use, so they
+    //  can be recorded while those frames execute
+    VkCommandBuffer commandBuffer = app->_beginSingleTimeCommands();
+
+    // Textures first, VMA doesn't allow allocations while its defragmentation runs
+    std::vector<UniformTexture *> movedTextures;
+    for (size_t i = 0; i < textures.size() && movesLeft > 0; i++)
+    {
+        nextTexture = (nextTexture + 1) % textures.size();
+        UniformTexture *texture = textures[nextTexture];
+
+        VkDeviceSize size = texture->_getAllocationSize();
+        if (size <= bytesLeft && texture->_beginRelocation(commandBuffer))
+        {
+            movedTextures.push_back(texture);
+            stats.bytesMoved += size;
+            bytesLeft -= size;
+            movesLeft--;
+        }
+    }
+    moved += movedTextures.size();
+
+    std::vector<VkBool32> allocationsChanged;
+    VmaDefragmentationContext context =
+        beginBufferMoves(commandBuffer, bytesLeft, movesLeft, allocationsChanged, moved);
+
+    if (moved == 0)
+    {
+        // Nothing was recorded, so there's nothing to submit or wait for
+        vkEndCommandBuffer(commandBuffer);
+        vkFreeCommandBuffers(vulkanData->device, vulkanData->commandPool, 1, &commandBuffer);
+        vmaDefragmentationEnd(vulkanData->allocator, context);
+    }
+    else
+    {
+        // The copies transition and overwrite memory that frames in flight may
+        //  use, and must complete before the old memory is released
+        waitForFramesInFlight();
+        gpuIdle = true;
+
+        app->_endSingleTimeCommands(commandBuffer);
+        endBufferMoves(context, allocationsChanged);
+
+        for (UniformTexture *texture : movedTextures)
+        {
+            texture->_finishRelocation();
+        }
+    }
+
+    // CPU moves overwrite memory immediately, and are made with the remaining budget
+    if (gpuIdle)
+    {
+        context = beginBufferMoves(VK_NULL_HANDLE, bytesLeft, movesLeft, allocationsChanged,
+                                   moved);
+        endBufferMoves(context, allocationsChanged);
+    }
+
+    stats.passes++;
+    stats.allocationsMoved += moved;
+
+    if (moved > 0)
+    {
+        generation++;
+    }
+
+    return moved > 0;
+}
+
+uint64_t Defragmenter::getGeneration() { return generation; }
+
+void Defragmenter::setMaxBytesPerPass(VkDeviceSize maxBytesPerPass)
+{
+    this->maxBytesPerPass = maxBytesPerPass;
+}
+
+void Defragmenter::setMaxMovesPerPass(uint32_t maxMovesPerPass)
+{
+    this->maxMovesPerPass = maxMovesPerPass;
+}
+
+DefragmentationStats Defragmenter::getStats() { return stats; }
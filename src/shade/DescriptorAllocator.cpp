@@ -0,0 +1,326 @@
+#include "shade/DescriptorAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Shade;
+
+// Descriptors of each type reserved per set in a pool
+static const struct
+{
+    VkDescriptorType type;
+    uint32_t countPerSet;
+} poolSizeRatios[] = {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2},
+                      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2},
+                      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+                      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+                      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}};
+
+// Bit mask of every frame, a bit is cleared when the frame begins again
+static uint64_t getFrameMask(size_t frameCount)
+{
+    if (frameCount > 64)
+    {
+        throw std::runtime_error("Shade: Too many frames for descriptor set reuse!");
+    }
+
+    return frameCount == 64 ? ~0ull : (1ull << frameCount) - 1;
+}
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t frameCount,
+                                         uint32_t setsPerPool, uint32_t maxSetsPerPool)
+{
+    this->device = device;
+    this->setsPerPool = setsPerPool;
+    this->maxSetsPerPool = maxSetsPerPool;
+
+    currentPool = VK_NULL_HANDLE;
+
+    framePools.resize(frameCount > 0 ? frameCount : 1);
+    currentFrame = 0;
+
+    // Fails early rather than on the first released set
+    getFrameMask(framePools.size());
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    for (VkDescriptorPool pool : pools)
+    {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+
+    for (auto &framePoolList : framePools)
+    {
+        for (VkDescriptorPool pool : framePoolList)
+        {
+            vkDestroyDescriptorPool(device, pool, nullptr);
+        }
+    }
+
+    for (VkDescriptorPool pool : freeTransientPools)
+    {
+        vkDestroyDescriptorPool(device, pool, nullptr);
+    }
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets,
+                                                 VkDescriptorPoolCreateFlags flags)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const auto &ratio : poolSizeRatios)
+    {
+        poolSizes.push_back({ratio.type, ratio.countPerSet * maxSets});
+    }
+
+    VkDescriptorPoolCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    createInfo.pNext = nullptr;
+    createInfo.flags = flags;
+    createInfo.maxSets = maxSets;
+    createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    createInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device, &createInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create descriptor pool!");
+    }
+
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::grabTransientPool()
+{
+    if (!freeTransientPools.empty())
+    {
+        VkDescriptorPool pool = freeTransientPools.back();
+        freeTransientPools.pop_back();
+        return pool;
+    }
+
+    // Transient sets are never freed individually, so the pool doesn't need
+    //  VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+    return createPool(maxSetsPerPool, 0);
+}
+
+VkResult DescriptorAllocator::allocateFromPool(VkDescriptorPool pool, VkDescriptorSetLayout layout,
+                                               VkDescriptorSet *set)
+{
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = nullptr;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    return vkAllocateDescriptorSets(device, &allocInfo, set);
+}
+
+bool DescriptorAllocator::allocateFromReclaimablePools(VkDescriptorSetLayout layout,
+                                                       VkDescriptorSet *set)
+{
+    while (!reclaimablePools.empty())
+    {
+        VkDescriptorPool pool = *reclaimablePools.begin();
+
+        if (allocateFromPool(pool, layout, set) == VK_SUCCESS)
+        {
+            currentPool = pool;
+            return true;
+        }
+
+        // Pool is full again or too fragmented to be useful
+        reclaimablePools.erase(reclaimablePools.begin());
+    }
+
+    return false;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+{
+    // Reuse a previously released set with the same layout
+    auto recycled = freeSets.find(layout);
+    if (recycled != freeSets.end() && !recycled->second.empty())
+    {
+        VkDescriptorSet set = recycled->second.back();
+        recycled->second.pop_back();
+        return set;
+    }
+
+    VkDescriptorSet set = VK_NULL_HANDLE;
+
+    // Pre-1.1 drivers may report an exhausted pool with any allocation error,
+    //  so every failure is treated as needing a different pool.
+    bool allocated = currentPool != VK_NULL_HANDLE &&
+                     allocateFromPool(currentPool, layout, &set) == VK_SUCCESS;
+
+    if (!allocated)
+    {
+        reclaimablePools.erase(currentPool);
+        allocated = allocateFromReclaimablePools(layout, &set);
+    }
+
+    if (!allocated)
+    {
+        currentPool = createPool(setsPerPool, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+        pools.push_back(currentPool);
+
+        // Grow the next pool
+        setsPerPool = std::min(setsPerPool * 2, maxSetsPerPool);
+
+        if (allocateFromPool(currentPool, layout, &set) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Shade: Failed to allocate descriptor set!");
+        }
+    }
+
+    setPools[set] = currentPool;
+
+    return set;
+}
+
+void DescriptorAllocator::release(VkDescriptorSetLayout layout, VkDescriptorSet set)
+{
+    if (set == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    // Frames in flight may still use the set; it must not be rewritten yet
+    retiringSets.push_back({layout, set, getFrameMask(framePools.size())});
+}
+
+void DescriptorAllocator::freeSet(VkDescriptorSet set)
+{
+    auto setPool = setPools.find(set);
+    if (setPool == setPools.end())
+    {
+        return;
+    }
+
+    vkFreeDescriptorSets(device, setPool->second, 1, &set);
+    reclaimablePools.insert(setPool->second);
+
+    setPools.erase(setPool);
+}
+
+void DescriptorAllocator::recycleSet(const RetiringSet &retiring)
+{
+    if (retiring.layout == VK_NULL_HANDLE)
+    {
+        freeSet(retiring.set);
+    }
+    else
+    {
+        freeSets[retiring.layout].push_back(retiring.set);
+    }
+}
+
+void DescriptorAllocator::releaseLayout(VkDescriptorSetLayout layout)
+{
+    // Sets still in use are freed once their frames have finished
+    for (RetiringSet &retiring : retiringSets)
+    {
+        if (retiring.layout == layout)
+        {
+            retiring.layout = VK_NULL_HANDLE;
+        }
+    }
+
+    auto recycled = freeSets.find(layout);
+    if (recycled == freeSets.end())
+    {
+        return;
+    }
+
+    for (VkDescriptorSet set : recycled->second)
+    {
+        freeSet(set);
+    }
+
+    freeSets.erase(recycled);
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout)
+{
+    std::vector<VkDescriptorPool> &framePoolList = framePools[currentFrame];
+
+    if (framePoolList.empty())
+    {
+        framePoolList.push_back(grabTransientPool());
+    }
+
+    VkDescriptorSet set;
+    if (allocateFromPool(framePoolList.back(), layout, &set) != VK_SUCCESS)
+    {
+        framePoolList.push_back(grabTransientPool());
+
+        if (allocateFromPool(framePoolList.back(), layout, &set) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Shade: Failed to allocate transient descriptor set!");
+        }
+    }
+
+    return set;
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+{
+    if (frameIndex >= framePools.size())
+    {
+        framePools.resize(frameIndex + 1);
+    }
+
+    currentFrame = frameIndex;
+
+    // Free every set the frame allocated last time in one go
+    for (VkDescriptorPool pool : framePools[currentFrame])
+    {
+        vkResetDescriptorPool(device, pool, 0);
+        freeTransientPools.push_back(pool);
+    }
+
+    framePools[currentFrame].clear();
+
+    // Sets released since the frame was last started can't be used by it anymore
+    for (size_t i = 0; i < retiringSets.size();)
+    {
+        RetiringSet &retiring = retiringSets[i];
+        retiring.pendingFrames &= ~(1ull << frameIndex);
+
+        if (retiring.pendingFrames != 0)
+        {
+            i++;
+            continue;
+        }
+
+        recycleSet(retiring);
+        retiring = retiringSets.back();
+        retiringSets.pop_back();
+    }
+}
+
+void DescriptorAllocator::setFrameCount(uint32_t frameCount)
+{
+    frameCount = frameCount > 0 ? frameCount : 1;
+    getFrameMask(frameCount);
+
+    // Frames that no longer exist give their transient pools back
+    for (size_t i = frameCount; i < framePools.size(); i++)
+    {
+        for (VkDescriptorPool pool : framePools[i])
+        {
+            vkResetDescriptorPool(device, pool, 0);
+            freeTransientPools.push_back(pool);
+        }
+    }
+    framePools.resize(frameCount);
+    currentFrame = 0;
+
+    for (const RetiringSet &retiring : retiringSets)
+    {
+        recycleSet(retiring);
+    }
+    retiringSets.clear();
+}
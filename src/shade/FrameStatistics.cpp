@@ -0,0 +1,127 @@
+#include "shade/FrameStatistics.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Shade;
+
+// Frames between median updates used for hitch detection
+static const uint32_t medianUpdateInterval = 30;
+
+FrameStatistics::FrameStatistics(size_t capacity, double hitchThreshold)
+{
+    frameTimes.resize(std::max(capacity, (size_t)1));
+    this->hitchThreshold = hitchThreshold;
+
+    reset();
+}
+
+void FrameStatistics::reset()
+{
+    nextFrame = 0;
+    storedFrames = 0;
+
+    totalFrames = 0;
+    hitchCount = 0;
+
+    cachedMedian = 0;
+    framesSinceMedianUpdate = 0;
+
+    secondElapsed = 0;
+    secondFrames = 0;
+    framesPerSecond = 0;
+}
+
+double FrameStatistics::percentile(std::vector<double> &sortedTimes, double fraction)
+{
+    // Nearest-rank percentile
+    size_t rank = (size_t)std::ceil(fraction * sortedTimes.size());
+    return sortedTimes[std::min(std::max(rank, (size_t)1), sortedTimes.size()) - 1];
+}
+
+void FrameStatistics::addFrame(double frameTime)
+{
+    // Compare against the median before this frame influences it
+    if (cachedMedian > 0 && frameTime > cachedMedian * hitchThreshold)
+    {
+        hitchCount++;
+    }
+
+    frameTimes[nextFrame] = frameTime;
+    nextFrame = (nextFrame + 1) % frameTimes.size();
+    storedFrames = std::min(storedFrames + 1, frameTimes.size());
+    totalFrames++;
+
+    if (++framesSinceMedianUpdate >= medianUpdateInterval || cachedMedian == 0)
+    {
+        std::vector<double> times(frameTimes.begin(), frameTimes.begin() + storedFrames);
+        std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+        cachedMedian = times[times.size() / 2];
+
+        framesSinceMedianUpdate = 0;
+    }
+
+    // Count frames per whole second of frame time
+    secondElapsed += frameTime;
+    secondFrames++;
+    if (secondElapsed >= 1.0)
+    {
+        framesPerSecond = secondFrames / secondElapsed;
+        secondElapsed = 0;
+        secondFrames = 0;
+    }
+}
+
+FrameStatisticsSummary FrameStatistics::getSummary()
+{
+    FrameStatisticsSummary summary;
+
+    summary.totalFrames = totalFrames;
+    summary.hitchCount = hitchCount;
+    summary.framesPerSecond = framesPerSecond;
+
+    if (storedFrames == 0)
+    {
+        return summary;
+    }
+
+    std::vector<double> times(frameTimes.begin(), frameTimes.begin() + storedFrames);
+    std::sort(times.begin(), times.end());
+
+    summary.frameCount = static_cast<uint32_t>(times.size());
+    summary.p50 = percentile(times, 0.50);
+    summary.p95 = percentile(times, 0.95);
+    summary.p99 = percentile(times, 0.99);
+    summary.min = times.front();
+    summary.max = times.back();
+
+    double total = 0;
+    for (double time : times)
+    {
+        total += time;
+    }
+    summary.mean = total / times.size();
+
+    return summary;
+}
+
+void FrameStatistics::setHitchThreshold(double hitchThreshold)
+{
+    this->hitchThreshold = hitchThreshold;
+}
+
+double FrameStatistics::getHitchThreshold() { return hitchThreshold; }
+
+void FrameStatistics::dump(std::ostream &stream)
+{
+    FrameStatisticsSummary summary = getSummary();
+
+    stream << "Shade: Frame statistics (last " << summary.frameCount << " of "
+           << summary.totalFrames << " frames)" << std::endl;
+    stream << "  p50: " << summary.p50 * 1000.0 << " ms, p95: " << summary.p95 * 1000.0
+           << " ms, p99: " << summary.p99 * 1000.0 << " ms" << std::endl;
+    stream << "  min: " << summary.min * 1000.0 << " ms, max: " << summary.max * 1000.0
+           << " ms, mean: " << summary.mean * 1000.0 << " ms" << std::endl;
+    stream << "  hitches (> " << hitchThreshold << "x median): " << summary.hitchCount
+           << ", throughput: " << summary.framesPerSecond << " fps" << std::endl;
+}
@@ -0,0 +1,242 @@
+#include "shade/GpuProfiler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace Shade;
+
+GpuProfiler::GpuProfiler(VulkanApplicationData *vulkanData, uint32_t frameCount,
+                         uint32_t maxScopesPerFrame, uint32_t historyLength)
+{
+    this->vulkanData = vulkanData;
+    this->maxQueriesPerFrame = maxScopesPerFrame * 2;
+    this->historyLength = std::max(historyLength, 1u);
+
+    queryPool = VK_NULL_HANDLE;
+    currentFrame = 0;
+
+    // Timestamps are only meaningful if the graphics queue writes valid bits
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vulkanData->physicalDevice, &queueFamilyCount,
+                                             nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(vulkanData->physicalDevice, &queueFamilyCount,
+                                             queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[vulkanData->graphicsQueueFamilyIndex].timestampValidBits;
+
+    timestampPeriod = vulkanData->physicalDeviceProperties.limits.timestampPeriod;
+    timestampMask = validBits >= 64 ? UINT64_MAX : ((uint64_t)1 << validBits) - 1;
+
+    supported = validBits > 0 && timestampPeriod > 0;
+
+    createQueryPool(frameCount);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(vulkanData->device, queryPool, nullptr);
+    }
+}
+
+void GpuProfiler::createQueryPool(uint32_t frameCount)
+{
+    frames.clear();
+    frames.resize(std::max(frameCount, 1u));
+    currentFrame = 0;
+
+    if (!supported)
+    {
+        return;
+    }
+
+    VkQueryPoolCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.pNext = nullptr;
+    createInfo.flags = 0;
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = maxQueriesPerFrame * static_cast<uint32_t>(frames.size());
+    createInfo.pipelineStatistics = 0;
+
+    if (vkCreateQueryPool(vulkanData->device, &createInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create timestamp query pool!");
+    }
+}
+
+void GpuProfiler::setFrameCount(uint32_t frameCount)
+{
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(vulkanData->device, queryPool, nullptr);
+        queryPool = VK_NULL_HANDLE;
+    }
+
+    createQueryPool(frameCount);
+}
+
+void GpuProfiler::readResults(FrameQueries &frame)
+{
+    if (frame.queryCount == 0)
+    {
+        return;
+    }
+
+    uint32_t firstQuery = currentFrame * maxQueriesPerFrame;
+
+    std::vector<uint64_t> timestamps(frame.queryCount);
+    VkResult result = vkGetQueryPoolResults(
+        vulkanData->device, queryPool, firstQuery, frame.queryCount,
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+
+    if (result != VK_SUCCESS)
+    {
+        // Frame was never submitted (e.g. skipped during a resize)
+        return;
+    }
+
+    // Sum repeated scopes into one sample per frame
+    std::map<std::string, float> frameSamples;
+    for (const Scope &scope : frame.scopes)
+    {
+        if (scope.endQuery == UINT32_MAX)
+        {
+            // Scope was never ended
+            continue;
+        }
+
+        uint64_t ticks = (timestamps[scope.endQuery] - timestamps[scope.beginQuery]) & timestampMask;
+        frameSamples[scope.name] += (float)(ticks * (double)timestampPeriod / 1000000.0);
+    }
+
+    for (const auto &sample : frameSamples)
+    {
+        std::deque<float> &samples = history[sample.first];
+        samples.push_back(sample.second);
+
+        if (samples.size() > historyLength)
+        {
+            samples.pop_front();
+        }
+    }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (!supported)
+    {
+        return;
+    }
+
+    currentFrame = frameIndex % static_cast<uint32_t>(frames.size());
+    FrameQueries &frame = frames[currentFrame];
+
+    // Previous submission of this slot has finished, so this doesn't wait
+    readResults(frame);
+
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    openScopes.clear();
+
+    vkCmdResetQueryPool(commandBuffer, queryPool, currentFrame * maxQueriesPerFrame,
+                        maxQueriesPerFrame);
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string &name)
+{
+    if (!supported)
+    {
+        return;
+    }
+
+    FrameQueries &frame = frames[currentFrame];
+
+    // Keep a query spare for the end of every scope already open
+    if (frame.queryCount + openScopes.size() + 2 > maxQueriesPerFrame)
+    {
+        // Mark as dropped so endScope stays balanced
+        openScopes.push_back(SIZE_MAX);
+        return;
+    }
+
+    Scope scope;
+    scope.name = name;
+    scope.beginQuery = frame.queryCount++;
+    scope.endQuery = UINT32_MAX;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool,
+                        currentFrame * maxQueriesPerFrame + scope.beginQuery);
+
+    openScopes.push_back(frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer)
+{
+    if (!supported || openScopes.empty())
+    {
+        return;
+    }
+
+    size_t scopeIndex = openScopes.back();
+    openScopes.pop_back();
+
+    if (scopeIndex == SIZE_MAX)
+    {
+        return;
+    }
+
+    FrameQueries &frame = frames[currentFrame];
+    Scope &scope = frame.scopes[scopeIndex];
+    scope.endQuery = frame.queryCount++;
+
+    // Timestamp once all preceding work has completed
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+                        currentFrame * maxQueriesPerFrame + scope.endQuery);
+}
+
+bool GpuProfiler::isSupported() { return supported; }
+
+GpuScopeStats GpuProfiler::getScopeStats(const std::string &name)
+{
+    GpuScopeStats stats;
+
+    auto samples = history.find(name);
+    if (samples == history.end() || samples->second.empty())
+    {
+        return stats;
+    }
+
+    stats.lastMs = samples->second.back();
+    stats.minMs = samples->second.front();
+    stats.maxMs = samples->second.front();
+    stats.sampleCount = static_cast<uint32_t>(samples->second.size());
+
+    float total = 0;
+    for (float sample : samples->second)
+    {
+        total += sample;
+        stats.minMs = std::min(stats.minMs, sample);
+        stats.maxMs = std::max(stats.maxMs, sample);
+    }
+    stats.averageMs = total / stats.sampleCount;
+
+    return stats;
+}
+
+std::map<std::string, GpuScopeStats> GpuProfiler::getAllScopeStats()
+{
+    std::map<std::string, GpuScopeStats> allStats;
+
+    for (const auto &samples : history)
+    {
+        allStats[samples.first] = getScopeStats(samples.first);
+    }
+
+    return allStats;
+}
+
+void GpuProfiler::clearHistory() { history.clear(); }
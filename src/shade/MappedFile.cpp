@@ -0,0 +1,116 @@
+#include "shade/MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Shade;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string path)
+{
+    data = nullptr;
+    size = 0;
+    mappingHandle = nullptr;
+
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Shade: Failed to open file '" + path + "'!");
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    // Empty files can't be mapped, leave data as nullptr
+    if (size > 0)
+    {
+        mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle != nullptr)
+        {
+            data = static_cast<const uint8_t *>(
+                MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+
+        if (data == nullptr)
+        {
+            if (mappingHandle != nullptr)
+            {
+                CloseHandle(mappingHandle);
+            }
+            CloseHandle(fileHandle);
+            throw std::runtime_error("Shade: Failed to map file '" + path + "'!");
+        }
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+        CloseHandle(mappingHandle);
+    }
+    CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(std::string path)
+{
+    data = nullptr;
+    size = 0;
+
+    fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        throw std::runtime_error("Shade: Failed to open file '" + path + "'!");
+    }
+
+    struct stat fileStat;
+    fstat(fileDescriptor, &fileStat);
+    size = static_cast<size_t>(fileStat.st_size);
+
+    // Empty files can't be mapped, leave data as nullptr
+    if (size > 0)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close(fileDescriptor);
+            throw std::runtime_error("Shade: Failed to map file '" + path + "'!");
+        }
+
+        // The whole file is read front to back once
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        data = static_cast<const uint8_t *>(mapping);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(data), size);
+    }
+    close(fileDescriptor);
+}
+
+#endif
+
+const uint8_t *MappedFile::getData() { return data; }
+
+size_t MappedFile::getSize() { return size; }
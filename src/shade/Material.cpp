@@ -1,5 +1,8 @@
 #include "shade/Material.hpp"
 
+#include "shade/Defragmenter.hpp"
+
+#include <algorithm>
 #include <iostream>
 
 using namespace Shade;
@@ -21,10 +24,24 @@ Material::Material(VulkanApplication *_app, Shader *shader)
 	// Create descriptor sets
 	descriptorSet = shader->_getNewDescriptorSet();
 
+	// Nothing is staged until uniforms are set
+	uint32_t uniformCount = shader->_getUniformCount();
+	descriptorInfos.resize(uniformCount, UniformDescriptorInfo{});
+	assignedUniforms.resize(uniformCount, false);
+	dirtyUniforms.resize(uniformCount, false);
+	hasPendingWrites = false;
+
+	uniformSources.resize(uniformCount, UniformBufferData{});
+	defragmentationGeneration = 0;
+	if (vulkanData->defragmenter != nullptr)
+	{
+		defragmentationGeneration = vulkanData->defragmenter->getGeneration();
+	}
+
 	// Create default offsets
 	dynamicUniformOffsets = new std::vector<uint32_t>();
 
-	int totalDynamicUniforms = shader->getShaderLayout().getDynamicUniformStrides(app).size();
+	int totalDynamicUniforms = shader->_getDynamicUniformStrides().size();
 	for(int i = 0; i < totalDynamicUniforms; i++)
 	{
 		dynamicUniformOffsets->push_back(0);
@@ -38,8 +55,8 @@ Material::Material(VulkanApplication *_app, Shader *shader)
  */
 Material::~Material()
 {
-	vkFreeDescriptorSets(vulkanData->device, vulkanData->descriptorPool, 1,
-						 &descriptorSet);
+	// Hand the descriptor set back for reuse by the next material
+	shader->_releaseDescriptorSet(descriptorSet);
 
 	delete dynamicUniformOffsets;
 }
@@ -53,23 +70,21 @@ Material::~Material()
  */
 int Material::getUniformIndex(std::string uniformName)
 {
-	// Get shader uniform layout
-	std::vector<UniformLayoutEntry> uniformLayout =
-		shader->getShaderLayout().uniformsLayout;
-
-	// Find the matching uniform
-	int i = 0;
-	for (const auto uniformEntry : uniformLayout)
-	{
-		if (!uniformEntry.name.compare(uniformName))
-		{
-			// Match found
-			return i;
-		}
-		i++;
-	}
+	// Lookup table is precomputed by the shader
+	return shader->_getUniformIndex(uniformName);
+}
 
-	return -1;
+/**
+ * Mark the uniform at the given index as needing to be written by the next
+ *  commit.
+ * 
+ * @param uniformIndex index of the modified uniform
+ */
+void Material::markUniformDirty(int uniformIndex)
+{
+	assignedUniforms[uniformIndex] = true;
+	dirtyUniforms[uniformIndex] = true;
+	hasPendingWrites = true;
 }
 
 /**
@@ -80,30 +95,14 @@ int Material::getUniformIndex(std::string uniformName)
  */
 void Material::setUniformStructuredBuffer(int uniformIndex, StructuredUniformBuffer *buffer)
 {
-	// Update vulkan descriptor set
-	VkDescriptorBufferInfo bufferInfo;
+	// Stage descriptor info, written to the GPU on commit
+	VkDescriptorBufferInfo &bufferInfo = descriptorInfos.at(uniformIndex).bufferInfo;
 	bufferInfo.buffer = buffer->_getVkBuffer();
 	bufferInfo.offset = 0;
 	bufferInfo.range = buffer->getStride();
 
-	ShaderLayout shaderLayout = shader->getShaderLayout();
-	UniformLayoutEntry uniformEntry = shaderLayout.uniformsLayout.at(uniformIndex);
-
-	VkWriteDescriptorSet descriptorWrite = {};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite.dstSet = descriptorSet;
-	descriptorWrite.dstBinding = uniformEntry.binding;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorType = buffer->getDynamic() ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.pBufferInfo = &bufferInfo;
-	descriptorWrite.pImageInfo = nullptr;
-	descriptorWrite.pTexelBufferView = nullptr;
-
-	// Write to GPU
-	vkUpdateDescriptorSets(vulkanData->device,
-						   1,
-						   &descriptorWrite, 0, nullptr);
+	uniformSources.at(uniformIndex) = buffer;
+	markUniformDirty(uniformIndex);
 }
 
 /**
@@ -114,30 +113,150 @@ void Material::setUniformStructuredBuffer(int uniformIndex, StructuredUniformBuf
  */
 void Material::setUniformTexture(int uniformIndex, UniformTexture *texture)
 {
-	// Update vulkan descriptor set
-	VkDescriptorImageInfo imageInfo;
+	// Stage descriptor info, written to the GPU on commit
+	VkDescriptorImageInfo &imageInfo = descriptorInfos.at(uniformIndex).imageInfo;
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	imageInfo.imageView = texture->_getTextureImageView();
 	imageInfo.sampler = texture->_getTextureSampler();
 
-	ShaderLayout shaderLayout = shader->getShaderLayout();
-	UniformLayoutEntry uniformEntry = shaderLayout.uniformsLayout.at(uniformIndex);
-
-	VkWriteDescriptorSet descriptorWrite = {};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite.dstSet = descriptorSet;
-	descriptorWrite.dstBinding = uniformEntry.binding;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.pBufferInfo = nullptr;
-	descriptorWrite.pImageInfo = &imageInfo;
-	descriptorWrite.pTexelBufferView = nullptr;
-
-	// Write to GPU
-	vkUpdateDescriptorSets(vulkanData->device,
-						   1,
-						   &descriptorWrite, 0, nullptr);
+	uniformSources.at(uniformIndex) = texture;
+	markUniformDirty(uniformIndex);
+}
+
+/**
+ * Stage the current handles of every uniform again if the defragmenter has
+ *  moved resources since they were staged.
+ */
+void Material::restageMovedUniforms()
+{
+	if (vulkanData->defragmenter == nullptr ||
+		vulkanData->defragmenter->getGeneration() == defragmentationGeneration)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < uniformSources.size(); i++)
+	{
+		if (!assignedUniforms[i])
+		{
+			continue;
+		}
+
+		if (Buffer **buffer = std::get_if<Buffer *>(&uniformSources[i]))
+		{
+			descriptorInfos[i].bufferInfo.buffer = (*buffer)->_getVkBuffer();
+		}
+		else if (UniformTexture **texture = std::get_if<UniformTexture *>(&uniformSources[i]))
+		{
+			descriptorInfos[i].imageInfo.imageView = (*texture)->_getTextureImageView();
+		}
+
+		markUniformDirty(i);
+	}
+
+	defragmentationGeneration = vulkanData->defragmenter->getGeneration();
+}
+
+/**
+ * Gather the writes for every uniform changed since the last commit.
+ * 
+ * Once every uniform has been assigned, the whole set is written straight
+ *  away through the shader's descriptor update template instead.
+ * 
+ * @param writes list to append descriptor writes to; the writes point into
+ *  the material's staged descriptor info
+ */
+void Material::collectDescriptorWrites(std::vector<VkWriteDescriptorSet> &writes)
+{
+	restageMovedUniforms();
+
+	if (!hasPendingWrites)
+	{
+		return;
+	}
+
+	VkDescriptorUpdateTemplate updateTemplate = shader->_getDescriptorUpdateTemplate();
+
+	bool allAssigned = std::find(assignedUniforms.begin(), assignedUniforms.end(), false) ==
+					   assignedUniforms.end();
+
+	if (updateTemplate != VK_NULL_HANDLE && allAssigned)
+	{
+		vkUpdateDescriptorSetWithTemplate(vulkanData->device, descriptorSet, updateTemplate,
+										  descriptorInfos.data());
+	}
+	else
+	{
+		for (size_t i = 0; i < dirtyUniforms.size(); i++)
+		{
+			if (!dirtyUniforms[i])
+			{
+				continue;
+			}
+
+			VkDescriptorType descriptorType = shader->_getUniformDescriptorType(i);
+			bool isImage = descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+			VkWriteDescriptorSet descriptorWrite = {};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = descriptorSet;
+			descriptorWrite.dstBinding = shader->_getUniformBinding(i);
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = descriptorType;
+			descriptorWrite.descriptorCount = 1;
+			descriptorWrite.pBufferInfo = isImage ? nullptr : &descriptorInfos[i].bufferInfo;
+			descriptorWrite.pImageInfo = isImage ? &descriptorInfos[i].imageInfo : nullptr;
+			descriptorWrite.pTexelBufferView = nullptr;
+
+			writes.push_back(descriptorWrite);
+		}
+	}
+
+	std::fill(dirtyUniforms.begin(), dirtyUniforms.end(), false);
+	hasPendingWrites = false;
+}
+
+/**
+ * Write all staged uniform changes to the material's descriptor set.
+ * 
+ * Called automatically before the material is rendered.
+ */
+void Material::commit()
+{
+	std::vector<VkWriteDescriptorSet> writes;
+	collectDescriptorWrites(writes);
+
+	if (!writes.empty())
+	{
+		vkUpdateDescriptorSets(vulkanData->device, static_cast<uint32_t>(writes.size()),
+							   writes.data(), 0, nullptr);
+	}
+}
+
+/**
+ * Write the staged uniform changes of several materials in a single
+ *  batched update.
+ * 
+ * @param materials materials to commit
+ */
+void Material::commitMaterials(const std::vector<Material *> &materials)
+{
+	if (materials.empty())
+	{
+		return;
+	}
+
+	std::vector<VkWriteDescriptorSet> writes;
+	for (Material *material : materials)
+	{
+		material->collectDescriptorWrites(writes);
+	}
+
+	if (!writes.empty())
+	{
+		vkUpdateDescriptorSets(materials[0]->vulkanData->device,
+							   static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
 }
 
 /**
@@ -159,6 +278,13 @@ Shader *Material::getShader()
  */
 VkDescriptorSet Material::_getDescriptorSet()
 {
+	restageMovedUniforms();
+
+	if (hasPendingWrites)
+	{
+		commit();
+	}
+
 	return this->descriptorSet;
 }
 
@@ -175,7 +301,7 @@ std::vector<uint32_t> *Material::getDynamicUniformOffsets()
  */
 std::vector<uint32_t> Material::_getVkDynamicUniformOffsets()
 {
-	std::vector<uint32_t> offsets = shader->getShaderLayout().getDynamicUniformStrides(app);
+	std::vector<uint32_t> offsets = shader->_getDynamicUniformStrides();
 
 	// Apply offsets
 	int i = 0;
@@ -0,0 +1,169 @@
+#include "shade/MemoryStatistics.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "shade/VulkanApplication.hpp"
+
+using namespace Shade;
+
+static double toMiB(VkDeviceSize bytes) { return bytes / (1024.0 * 1024.0); }
+
+MemoryStatistics::MemoryStatistics(VulkanApplicationData *vulkanData, float warningThreshold)
+{
+    this->vulkanData = vulkanData;
+    this->warningThreshold = warningThreshold;
+
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        categoryCounts[i] = 0;
+        categoryBytes[i] = 0;
+    }
+
+    heapsOverThreshold.resize(getHeapCount(), false);
+    frameIndex = 0;
+}
+
+uint32_t MemoryStatistics::getHeapCount()
+{
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkanData->allocator, &memoryProperties);
+
+    return memoryProperties->memoryHeapCount;
+}
+
+void MemoryStatistics::_trackAllocation(MemoryCategory category, VkDeviceSize bytes)
+{
+    categoryCounts[category].fetch_add(1, std::memory_order_relaxed);
+    categoryBytes[category].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void MemoryStatistics::_trackFree(MemoryCategory category, VkDeviceSize bytes)
+{
+    categoryCounts[category].fetch_sub(1, std::memory_order_relaxed);
+    categoryBytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void MemoryStatistics::beginFrame()
+{
+    // UINT32_MAX is reserved by VMA (VMA_FRAME_INDEX_LOST)
+    frameIndex = (frameIndex + 1) % UINT32_MAX;
+    vmaSetCurrentFrameIndex(vulkanData->allocator, frameIndex);
+
+    checkBudget();
+}
+
+void MemoryStatistics::checkBudget()
+{
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(vulkanData->allocator, budgets);
+
+    for (uint32_t i = 0; i < heapsOverThreshold.size(); i++)
+    {
+        bool overThreshold =
+            budgets[i].budget > 0 && budgets[i].usage >= budgets[i].budget * warningThreshold;
+
+        if (overThreshold && !heapsOverThreshold[i])
+        {
+            std::cout << "Shade: (Warning) Memory heap " << i << " is using "
+                      << toMiB(budgets[i].usage) << " MiB of its " << toMiB(budgets[i].budget)
+                      << " MiB budget, allocations may start to fail" << std::endl;
+        }
+
+        heapsOverThreshold[i] = overThreshold;
+    }
+}
+
+MemoryReport MemoryStatistics::getReport()
+{
+    MemoryReport report;
+    report.budgetFromDriver = vulkanData->memoryBudgetSupported;
+
+    const VkPhysicalDeviceMemoryProperties *memoryProperties;
+    vmaGetMemoryProperties(vulkanData->allocator, &memoryProperties);
+
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetBudget(vulkanData->allocator, budgets);
+
+    VmaStats stats;
+    vmaCalculateStats(vulkanData->allocator, &stats);
+
+    report.heaps.resize(memoryProperties->memoryHeapCount);
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++)
+    {
+        MemoryHeapStatistics &heap = report.heaps[i];
+        heap.size = memoryProperties->memoryHeaps[i].size;
+        heap.deviceLocal =
+            (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+        heap.blockBytes = budgets[i].blockBytes;
+        heap.allocationBytes = budgets[i].allocationBytes;
+        heap.usage = budgets[i].usage;
+        heap.budget = budgets[i].budget;
+
+        heap.largestFreeBlock = stats.memoryHeap[i].unusedRangeSizeMax;
+        report.largestFreeBlock = std::max(report.largestFreeBlock, heap.largestFreeBlock);
+    }
+
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        report.categories[i].allocationCount = categoryCounts[i].load(std::memory_order_relaxed);
+        report.categories[i].bytes = categoryBytes[i].load(std::memory_order_relaxed);
+    }
+
+    return report;
+}
+
+void MemoryStatistics::setWarningThreshold(float warningThreshold)
+{
+    this->warningThreshold = warningThreshold;
+}
+
+float MemoryStatistics::getWarningThreshold() { return warningThreshold; }
+
+void MemoryStatistics::dump(std::ostream &stream)
+{
+    MemoryReport report = getReport();
+
+    stream << "Shade: Memory statistics ("
+           << (report.budgetFromDriver ? "driver reported budget" : "estimated budget") << ")"
+           << std::endl;
+
+    for (uint32_t i = 0; i < report.heaps.size(); i++)
+    {
+        MemoryHeapStatistics &heap = report.heaps[i];
+        stream << "  heap " << i << (heap.deviceLocal ? " (device local)" : "")
+               << ": usage " << toMiB(heap.usage) << " / " << toMiB(heap.budget)
+               << " MiB budget, allocated " << toMiB(heap.allocationBytes) << " of "
+               << toMiB(heap.blockBytes) << " MiB in blocks, largest free block "
+               << toMiB(heap.largestFreeBlock) << " MiB" << std::endl;
+    }
+
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        stream << "  " << getCategoryName((MemoryCategory)i) << ": "
+               << report.categories[i].allocationCount << " allocations, "
+               << toMiB(report.categories[i].bytes) << " MiB" << std::endl;
+    }
+}
+
+const char *MemoryStatistics::getCategoryName(MemoryCategory category)
+{
+    switch (category)
+    {
+    case MEMORY_CATEGORY_VERTEX:
+        return "vertex";
+    case MEMORY_CATEGORY_INDEX:
+        return "index";
+    case MEMORY_CATEGORY_UNIFORM:
+        return "uniform";
+    case MEMORY_CATEGORY_TEXTURE:
+        return "texture";
+    case MEMORY_CATEGORY_STAGING:
+        return "staging";
+    case MEMORY_CATEGORY_ATTACHMENT:
+        return "attachment";
+    default:
+        return "unknown";
+    }
+}
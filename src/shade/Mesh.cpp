@@ -8,6 +8,8 @@
 #include <regex>
 #include <map>
 
+#include "shade/Profiler.hpp"
+
 using namespace Shade;
 
 /**
@@ -167,6 +169,8 @@ Mesh *Mesh::loadFromPLY(VulkanApplication *app, std::string path,
                         StructuredBufferLayout vertexLayout,
                         bool swapZYAxis)
 {
+    SHADE_PROFILE_ZONE("Mesh::loadFromPLY");
+
     std::fstream file;
     file.open(path, std::ios::in);
 
@@ -465,6 +469,8 @@ Mesh *Mesh::loadFromPLY(VulkanApplication *app, std::string path,
 Mesh *Mesh::loadFromOBJ(VulkanApplication *app, std::string path,
                         StructuredBufferLayout vertexLayout)
 {
+    SHADE_PROFILE_ZONE("Mesh::loadFromOBJ");
+
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -0,0 +1,460 @@
+#include "shade/MipDownsampler.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "shade/Buffer.hpp"
+#include "shade/Defragmenter.hpp"
+#include "shade/DescriptorAllocator.hpp"
+#include "shade/MipGenerator.hpp"
+#include "shade/PipelineCache.hpp"
+#include "shade/TextureFormat.hpp"
+
+using namespace Shade;
+
+#ifdef SHADE_COMPUTE_SHADERS
+// SPIR-V of shaders/MipDownsampler.comp, compiled by glslc at build time
+static const uint32_t mipDownsamplerSpirv[] = {
+#include "shade/shaders/MipDownsampler.comp.inc"
+};
+#endif
+
+// Matches the push constants of MipDownsampler.comp
+struct MipDownsamplerPushConstants
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t workGroupCount;
+    uint32_t tilesX;
+    uint32_t srgb;
+};
+
+// Texels of level 0 reduced by each workgroup, along each axis
+static const uint32_t TILE_SIZE = 64;
+
+// Storage images can't have sRGB formats, levels of sRGB images are written
+//  through UNORM views and encoded by the shader
+static VkFormat getStorageFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_SRGB:
+        return VK_FORMAT_R8_UNORM;
+    case VK_FORMAT_R8G8_SRGB:
+        return VK_FORMAT_R8G8_UNORM;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return VK_FORMAT_B8G8R8A8_UNORM;
+    default:
+        return format;
+    }
+}
+
+MipDownsampler::MipDownsampler(VulkanApplication *app)
+{
+    this->app = app;
+    this->vulkanData = app->_getVulkanData();
+
+#ifdef SHADE_COMPUTE_SHADERS
+    VkDescriptorSetLayoutBinding bindings[4] = {};
+    VkDescriptorType types[4] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                 VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                 VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                 VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = types[i];
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[1].descriptorCount = MIP_DOWNSAMPLER_MAX_LEVELS;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = nullptr;
+    layoutInfo.flags = 0;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(vulkanData->device, &layoutInfo, nullptr,
+                                    &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create mip downsampler descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MipDownsamplerPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pNext = nullptr;
+    pipelineLayoutInfo.flags = 0;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(vulkanData->device, &pipelineLayoutInfo, nullptr,
+                               &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create mip downsampler pipeline layout!");
+    }
+
+    VkShaderModuleCreateInfo modInfo = {};
+    modInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    modInfo.pNext = nullptr;
+    modInfo.flags = 0;
+    modInfo.codeSize = sizeof(mipDownsamplerSpirv);
+    modInfo.pCode = mipDownsamplerSpirv;
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(vulkanData->device, &modInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create shader module!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(vulkanData->device,
+                                               vulkanData->pipelineCache->_getVkPipelineCache(),
+                                               1, &pipelineInfo, nullptr, &pipeline);
+    vkDestroyShaderModule(vulkanData->device, shaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create mip downsampler pipeline!");
+    }
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.flags = 0;
+    samplerInfo.pNext = nullptr;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(vulkanData->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create mip downsampler sampler!");
+    }
+#else
+    throw std::runtime_error("Shade: Shade was built without compute shaders, glslc is required "
+                             "for compute mip generation!");
+#endif
+}
+
+MipDownsampler::~MipDownsampler()
+{
+    vulkanData->descriptorAllocator->releaseLayout(descriptorSetLayout);
+
+    vkDestroySampler(vulkanData->device, sampler, nullptr);
+    vkDestroyPipeline(vulkanData->device, pipeline, nullptr);
+    vkDestroyPipelineLayout(vulkanData->device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(vulkanData->device, descriptorSetLayout, nullptr);
+}
+
+bool MipDownsampler::isFormatSupported(VkFormat format)
+{
+    if (TextureFormat::isBlockCompressed(format))
+    {
+        return false;
+    }
+
+    VkFormatProperties sampledProperties;
+    vkGetPhysicalDeviceFormatProperties(vulkanData->physicalDevice, format, &sampledProperties);
+
+    VkFormatProperties storageProperties;
+    vkGetPhysicalDeviceFormatProperties(vulkanData->physicalDevice, getStorageFormat(format),
+                                        &storageProperties);
+
+    return (sampledProperties.optimalTilingFeatures &
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) &&
+           (storageProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+}
+
+VkImageCreateFlags MipDownsampler::getImageCreateFlags(VkFormat format)
+{
+    // The UNORM storage views of sRGB images need a mutable format
+    return getStorageFormat(format) != format ? VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT : 0;
+}
+
+VkImageUsageFlags MipDownsampler::getImageUsage()
+{
+    return VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+}
+
+bool MipDownsampler::_isSupported(VulkanApplicationData *vulkanData)
+{
+#ifdef SHADE_COMPUTE_SHADERS
+    return vulkanData->storageImageWriteWithoutFormat;
+#else
+    (void)vulkanData;
+    return false;
+#endif
+}
+
+VkDescriptorSetLayout MipDownsampler::_getDescriptorSetLayout() { return descriptorSetLayout; }
+
+VkPipelineLayout MipDownsampler::_getPipelineLayout() { return pipelineLayout; }
+
+VkPipeline MipDownsampler::_getPipeline() { return pipeline; }
+
+VkSampler MipDownsampler::_getSampler() { return sampler; }
+
+MipDownsampleTarget::MipDownsampleTarget(VulkanApplication *app, VkImage image, VkFormat format,
+                                         uint32_t width, uint32_t height, uint32_t mipLevels)
+{
+    this->app = app;
+    this->vulkanData = app->_getVulkanData();
+    this->downsampler = vulkanData->mipDownsampler;
+    this->image = image;
+    this->format = format;
+    this->width = width;
+    this->height = height;
+    this->mipLevels = mipLevels;
+
+    if (downsampler == nullptr)
+    {
+        throw std::runtime_error("Shade: Compute mip generation isn't supported!");
+    }
+
+    if (!downsampler->isFormatSupported(format))
+    {
+        throw std::runtime_error("Shade: Compute mip generation isn't supported for the format!");
+    }
+
+    if (std::max(width, height) > MIP_DOWNSAMPLER_MAX_SIZE)
+    {
+        throw std::runtime_error("Shade: Image is too large for compute mip generation!");
+    }
+
+    if (mipLevels < 2 || mipLevels > MipGenerator::getMipLevelCount(width, height))
+    {
+        throw std::runtime_error("Shade: Invalid mip level count for compute mip generation!");
+    }
+
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    sourceView = createLevelView(format, 0);
+    for (uint32_t level = 1; level < mipLevels; level++)
+    {
+        levelViews.push_back(createLevelView(getStorageFormat(format), level));
+    }
+
+    // Level 6 texels are only exchanged between workgroups of larger chains,
+    //  but the descriptor is always bound
+    level6Buffer = new Buffer(app, nullptr, 4 * sizeof(float), tilesX * tilesY, STORAGE, GPU);
+
+    uint32_t finishedWorkGroups = 0;
+    counterBuffer = new Buffer(app, &finishedWorkGroups, sizeof(uint32_t), 1, STORAGE, GPU);
+
+    descriptorSet =
+        vulkanData->descriptorAllocator->allocate(downsampler->_getDescriptorSetLayout());
+    writeDescriptorSet();
+}
+
+MipDownsampleTarget::~MipDownsampleTarget()
+{
+    vulkanData->descriptorAllocator->release(downsampler->_getDescriptorSetLayout(),
+                                             descriptorSet);
+
+    delete counterBuffer;
+    delete level6Buffer;
+
+    for (VkImageView view : levelViews)
+    {
+        vkDestroyImageView(vulkanData->device, view, nullptr);
+    }
+    vkDestroyImageView(vulkanData->device, sourceView, nullptr);
+}
+
+VkImageView MipDownsampleTarget::createLevelView(VkFormat viewFormat, uint32_t level)
+{
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = viewFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = level;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    VkImageView view;
+    if (vkCreateImageView(vulkanData->device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create mip level image view!");
+    }
+
+    return view;
+}
+
+void MipDownsampleTarget::writeDescriptorSet()
+{
+    VkDescriptorImageInfo sourceInfo = {};
+    sourceInfo.sampler = downsampler->_getSampler();
+    sourceInfo.imageView = sourceView;
+    sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    // Every element of the array must be valid, unused ones repeat the last level
+    VkDescriptorImageInfo levelInfos[MIP_DOWNSAMPLER_MAX_LEVELS] = {};
+    for (uint32_t i = 0; i < MIP_DOWNSAMPLER_MAX_LEVELS; i++)
+    {
+        levelInfos[i].sampler = VK_NULL_HANDLE;
+        levelInfos[i].imageView = levelViews[std::min<size_t>(i, levelViews.size() - 1)];
+        levelInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorBufferInfo bufferInfos[2] = {};
+    bufferInfos[0].buffer = level6Buffer->_getVkBuffer();
+    bufferInfos[0].offset = 0;
+    bufferInfos[0].range = VK_WHOLE_SIZE;
+    bufferInfos[1].buffer = counterBuffer->_getVkBuffer();
+    bufferInfos[1].offset = 0;
+    bufferInfos[1].range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[4] = {};
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].pNext = nullptr;
+        writes[i].dstSet = descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorCount = 1;
+    }
+
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &sourceInfo;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].descriptorCount = MIP_DOWNSAMPLER_MAX_LEVELS;
+    writes[1].pImageInfo = levelInfos;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].pBufferInfo = &bufferInfos[0];
+    writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[3].pBufferInfo = &bufferInfos[1];
+
+    vkUpdateDescriptorSets(vulkanData->device, 4, writes, 0, nullptr);
+
+    if (vulkanData->defragmenter != nullptr)
+    {
+        defragmentationGeneration = vulkanData->defragmenter->getGeneration();
+    }
+}
+
+void MipDownsampleTarget::generate(VkCommandBuffer commandBuffer, VkImageLayout oldLayout,
+                                   VkImageLayout newLayout)
+{
+    // The buffers may have been moved since the set was last written, it
+    //  isn't in use as the GPU is idle while defragmenting
+    if (vulkanData->defragmenter != nullptr &&
+        vulkanData->defragmenter->getGeneration() != defragmentationGeneration)
+    {
+        writeDescriptorSet();
+    }
+
+    // Record into the caller's command buffer, or submit on our own
+    bool singleTime = commandBuffer == VK_NULL_HANDLE;
+    if (singleTime)
+    {
+        commandBuffer = app->_beginSingleTimeCommands();
+    }
+
+    VkImageMemoryBarrier barriers[2] = {};
+    for (VkImageMemoryBarrier &barrier : barriers)
+    {
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+    }
+
+    // Level 0 is sampled once its writes are visible
+    barriers[0].oldLayout = oldLayout;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[0].subresourceRange.baseMipLevel = 0;
+    barriers[0].subresourceRange.levelCount = 1;
+
+    // The other levels are overwritten, their previous contents are discarded
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].srcAccessMask = 0;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[1].subresourceRange.baseMipLevel = 1;
+    barriers[1].subresourceRange.levelCount = mipLevels - 1;
+
+    // Buffers written by the previous generation are read and written again
+    VkMemoryBarrier memoryBarrier = {};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr,
+                         2, barriers);
+
+    MipDownsamplerPushConstants pushConstants;
+    pushConstants.width = width;
+    pushConstants.height = height;
+    pushConstants.mipCount = mipLevels - 1;
+    pushConstants.workGroupCount = tilesX * tilesY;
+    pushConstants.tilesX = tilesX;
+    pushConstants.srgb = getStorageFormat(format) != format ? 1 : 0;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsampler->_getPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            downsampler->_getPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, downsampler->_getPipelineLayout(),
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, tilesX, tilesY, 1);
+
+    // Every level ends up in the requested layout, readable by later commands
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[0].newLayout = newLayout;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[1].newLayout = newLayout;
+    barriers[1].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 2,
+                         barriers);
+
+    if (singleTime)
+    {
+        app->_endSingleTimeCommands(commandBuffer);
+    }
+}
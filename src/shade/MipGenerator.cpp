@@ -0,0 +1,389 @@
+#include "shade/MipGenerator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+#include <stdexcept>
+
+#include "shade/Profiler.hpp"
+#include "shade/TextureFormat.hpp"
+#include "shade/ThreadPool.hpp"
+
+using namespace Shade;
+
+static const float PI = 3.14159265358979f;
+
+// Kaiser filter radius in texels of the smaller level, and window shape
+static const float KAISER_WIDTH = 3.0f;
+static const float KAISER_ALPHA = 4.0f;
+
+// Rows of levels smaller than this are filtered on the calling thread, the
+//  work isn't worth a task
+static const uint32_t MIN_TEXELS_PER_TASK = 16384;
+
+// Image with one plane of floats per channel
+struct PlanarImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<float> planes[4];
+};
+
+// Source texels contributing to each texel of a level along one axis, with
+//  tapCount entries per texel. Indices are clamped to the source image, so
+//  edges repeat the outermost texels
+struct FilterTaps
+{
+    uint32_t tapCount = 0;
+    std::vector<uint32_t> indices;
+    std::vector<float> weights;
+};
+
+static float besselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 32 && term > sum * 1e-7f; k++)
+    {
+        float factor = x / (2.0f * k);
+        term *= factor * factor;
+        sum += term;
+    }
+    return sum;
+}
+
+static float sinc(float x)
+{
+    if (std::abs(x) < 1e-6f)
+    {
+        return 1.0f;
+    }
+    return std::sin(PI * x) / (PI * x);
+}
+
+// Kaiser windowed sinc at a distance in texels of the smaller level
+static float kaiser(float x)
+{
+    float t = x / KAISER_WIDTH;
+    if (std::abs(t) >= 1.0f)
+    {
+        return 0.0f;
+    }
+    return sinc(x) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / besselI0(KAISER_ALPHA);
+}
+
+static FilterTaps computeTaps(MipFilter filter, uint32_t sourceSize, uint32_t size)
+{
+    float scale = static_cast<float>(sourceSize) / size;
+    float radius = filter == MIP_FILTER_BOX ? scale * 0.5f : KAISER_WIDTH * scale;
+    int32_t span = static_cast<int32_t>(std::ceil(radius * 2.0f)) + 2;
+
+    // Weigh every texel within the radius, then keep the range that contributes
+    std::vector<float> candidates(static_cast<size_t>(size) * span);
+    std::vector<int32_t> firstTexels(size);
+    std::vector<int32_t> firstCandidates(size);
+    int32_t tapCount = 1;
+
+    for (uint32_t x = 0; x < size; x++)
+    {
+        float center = (x + 0.5f) * scale;
+        int32_t first = static_cast<int32_t>(std::floor(center - radius));
+
+        float total = 0.0f;
+        int32_t firstUsed = span;
+        int32_t lastUsed = 0;
+        float *weights = &candidates[static_cast<size_t>(x) * span];
+        for (int32_t t = 0; t < span; t++)
+        {
+            float texel = static_cast<float>(first + t);
+            if (filter == MIP_FILTER_BOX)
+            {
+                // Part of the texel covered by the footprint
+                weights[t] = std::max(0.0f, std::min(texel + 1.0f, center + radius) -
+                                                std::max(texel, center - radius));
+            }
+            else
+            {
+                weights[t] = kaiser((texel + 0.5f - center) / scale);
+            }
+
+            if (weights[t] != 0.0f)
+            {
+                firstUsed = std::min(firstUsed, t);
+                lastUsed = std::max(lastUsed, t);
+            }
+            total += weights[t];
+        }
+
+        for (int32_t t = 0; t < span; t++)
+        {
+            weights[t] /= total;
+        }
+
+        firstTexels[x] = first + firstUsed;
+        firstCandidates[x] = firstUsed;
+        tapCount = std::max(tapCount, lastUsed - firstUsed + 1);
+    }
+
+    FilterTaps taps;
+    taps.tapCount = static_cast<uint32_t>(tapCount);
+    taps.indices.resize(static_cast<size_t>(size) * tapCount);
+    taps.weights.resize(static_cast<size_t>(size) * tapCount);
+
+    for (uint32_t x = 0; x < size; x++)
+    {
+        for (int32_t t = 0; t < tapCount; t++)
+        {
+            int32_t candidate = firstCandidates[x] + t;
+            int32_t texel = std::clamp(firstTexels[x] + t, 0, static_cast<int32_t>(sourceSize) - 1);
+
+            size_t i = static_cast<size_t>(x) * tapCount + t;
+            taps.indices[i] = static_cast<uint32_t>(texel);
+            taps.weights[i] =
+                candidate < span ? candidates[static_cast<size_t>(x) * span + candidate] : 0.0f;
+        }
+    }
+
+    return taps;
+}
+
+static float srgbToLinear(float value)
+{
+    // Every convertible sRGB format has 8-bit channels
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> table;
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            float value = i / 255.0f;
+            table[i] = value <= 0.04045f ? value / 12.92f
+                                         : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+
+    return table[static_cast<uint32_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f)];
+}
+
+static float linearToSrgb(float value)
+{
+    value = std::clamp(value, 0.0f, 1.0f);
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Filter rows of a level from the previous level
+static void filterRows(const PlanarImage &source, PlanarImage &image, uint32_t channels,
+                       const FilterTaps &horizontal, const FilterTaps &vertical,
+                       uint32_t firstRow, uint32_t lastRow)
+{
+    // Columns are filtered first: each tap scales a whole source row, which
+    //  vectorises, leaving the gathers for the narrower rows
+    std::vector<float> column(source.width);
+
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        for (uint32_t y = firstRow; y < lastRow; y++)
+        {
+            size_t firstTap = static_cast<size_t>(y) * vertical.tapCount;
+
+            std::fill(column.begin(), column.end(), 0.0f);
+            for (uint32_t t = 0; t < vertical.tapCount; t++)
+            {
+                const float *sourceRow = source.planes[c].data() +
+                                         static_cast<size_t>(vertical.indices[firstTap + t]) *
+                                             source.width;
+                float weight = vertical.weights[firstTap + t];
+
+                for (uint32_t x = 0; x < source.width; x++)
+                {
+                    column[x] += weight * sourceRow[x];
+                }
+            }
+
+            float *row = image.planes[c].data() + static_cast<size_t>(y) * image.width;
+            for (uint32_t x = 0; x < image.width; x++)
+            {
+                const uint32_t *indices = &horizontal.indices[x * horizontal.tapCount];
+                const float *weights = &horizontal.weights[x * horizontal.tapCount];
+
+                float sum = 0.0f;
+                for (uint32_t t = 0; t < horizontal.tapCount; t++)
+                {
+                    sum += weights[t] * column[indices[t]];
+                }
+                row[x] = sum;
+            }
+        }
+    }
+}
+
+// Undo the alpha weighting and sRGB linearisation of rows of a level and
+//  encode them into the level's format
+static void storeRows(const PlanarImage &image, VkFormat format, bool srgb, bool weighted,
+                      uint32_t firstRow, uint32_t lastRow, uint8_t *level)
+{
+    TextureFormatInfo info = TextureFormat::getInfo(format);
+    std::vector<float> rgba(static_cast<size_t>(image.width) * 4);
+
+    for (uint32_t y = firstRow; y < lastRow; y++)
+    {
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            float *texel = &rgba[static_cast<size_t>(x) * 4];
+            size_t i = static_cast<size_t>(y) * image.width + x;
+
+            texel[0] = texel[1] = texel[2] = 0.0f;
+            texel[3] = 1.0f;
+            for (uint32_t c = 0; c < info.channels; c++)
+            {
+                texel[c] = image.planes[c][i];
+            }
+
+            // Sharpening filters can overshoot below zero
+            float alpha = std::max(texel[3], 0.0f);
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                if (weighted)
+                {
+                    texel[c] = alpha > 0.0f ? texel[c] / alpha : 0.0f;
+                }
+                if (srgb)
+                {
+                    texel[c] = linearToSrgb(texel[c]);
+                }
+            }
+        }
+
+        TextureFormat::encodePixels(format, rgba.data(), image.width,
+                                    level + static_cast<size_t>(y) * image.width * info.blockSize);
+    }
+}
+
+MipGenerator::MipGenerator(ThreadPool *threadPool, MipFilter filter, bool alphaWeighted)
+{
+    this->threadPool = threadPool;
+    this->filter = filter;
+    this->alphaWeighted = alphaWeighted;
+}
+
+void MipGenerator::forEachRowRange(uint32_t rows, uint32_t texelsPerRow,
+                                   const std::function<void(uint32_t, uint32_t)> &work)
+{
+    uint64_t texels = static_cast<uint64_t>(rows) * texelsPerRow;
+    if (threadPool == nullptr || texels < MIN_TEXELS_PER_TASK)
+    {
+        work(0, rows);
+        return;
+    }
+
+    // A few tasks per thread, so that threads finishing early can help out
+    uint32_t taskCount = std::min(rows, threadPool->getThreadCount() * 4);
+    uint32_t rowsPerTask = (rows + taskCount - 1) / taskCount;
+
+    std::vector<std::future<void>> tasks;
+    for (uint32_t firstRow = 0; firstRow < rows; firstRow += rowsPerTask)
+    {
+        uint32_t lastRow = std::min(firstRow + rowsPerTask, rows);
+        tasks.push_back(
+            threadPool->enqueue([&work, firstRow, lastRow] { work(firstRow, lastRow); }));
+    }
+
+    for (std::future<void> &task : tasks)
+    {
+        task.get();
+    }
+}
+
+std::vector<std::vector<uint8_t>> MipGenerator::generate(const void *pixels, uint32_t width,
+                                                         uint32_t height, VkFormat format)
+{
+    SHADE_PROFILE_ZONE("MipGenerator::generate");
+
+    if (!TextureFormat::isConvertible(format))
+    {
+        throw std::runtime_error("Shade: Mip generator doesn't support the texture format!");
+    }
+
+    TextureFormatInfo info = TextureFormat::getInfo(format);
+    uint32_t channels = info.channels;
+    bool srgb = TextureFormat::isSRGB(format);
+    bool weighted = alphaWeighted && channels == 4;
+
+    std::vector<std::vector<uint8_t>> levels(getMipLevelCount(width, height));
+
+    const uint8_t *source = static_cast<const uint8_t *>(pixels);
+    levels[0].assign(source, source + TextureFormat::getLevelSize(format, width, height));
+
+    // Filtering happens on linear, alpha weighted planes
+    PlanarImage previous;
+    previous.width = width;
+    previous.height = height;
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        previous.planes[c].resize(static_cast<size_t>(width) * height);
+    }
+
+    forEachRowRange(height, width, [&](uint32_t firstRow, uint32_t lastRow) {
+        std::vector<float> rgba(static_cast<size_t>(width) * 4);
+        for (uint32_t y = firstRow; y < lastRow; y++)
+        {
+            const uint8_t *row = source + static_cast<size_t>(y) * width * info.blockSize;
+            TextureFormat::decodePixels(format, row, width, rgba.data());
+
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const float *texel = &rgba[static_cast<size_t>(x) * 4];
+                size_t i = static_cast<size_t>(y) * width + x;
+                for (uint32_t c = 0; c < channels; c++)
+                {
+                    float value = srgb && c < 3 ? srgbToLinear(texel[c]) : texel[c];
+                    previous.planes[c][i] = weighted && c < 3 ? value * texel[3] : value;
+                }
+            }
+        }
+    });
+
+    for (uint32_t level = 1; level < levels.size(); level++)
+    {
+        PlanarImage image;
+        image.width = std::max(width >> level, 1u);
+        image.height = std::max(height >> level, 1u);
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            image.planes[c].resize(static_cast<size_t>(image.width) * image.height);
+        }
+
+        FilterTaps horizontal = computeTaps(filter, previous.width, image.width);
+        FilterTaps vertical = computeTaps(filter, previous.height, image.height);
+
+        levels[level].resize(TextureFormat::getLevelSize(format, image.width, image.height));
+        uint8_t *destination = levels[level].data();
+
+        forEachRowRange(image.height, previous.width, [&](uint32_t firstRow, uint32_t lastRow) {
+            filterRows(previous, image, channels, horizontal, vertical, firstRow, lastRow);
+            storeRows(image, format, srgb, weighted, firstRow, lastRow, destination);
+        });
+
+        previous = std::move(image);
+    }
+
+    return levels;
+}
+
+void MipGenerator::setFilter(MipFilter filter) { this->filter = filter; }
+
+MipFilter MipGenerator::getFilter() { return filter; }
+
+void MipGenerator::setAlphaWeighted(bool alphaWeighted) { this->alphaWeighted = alphaWeighted; }
+
+bool MipGenerator::isAlphaWeighted() { return alphaWeighted; }
+
+uint32_t MipGenerator::getMipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+    {
+        levels++;
+    }
+    return levels;
+}
@@ -0,0 +1,151 @@
+#include "shade/PipelineCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Shade;
+
+// Size of the header at the start of all pipeline cache data
+//  (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+static const size_t cacheHeaderSize = 16 + VK_UUID_SIZE;
+
+PipelineCache::PipelineCache(VkDevice device, const VkPhysicalDeviceProperties &properties,
+                             std::string directory)
+{
+    this->device = device;
+
+    if (!directory.empty())
+    {
+        // Key the file by device and driver, as cache data is only valid for both
+        char uuid[VK_UUID_SIZE * 2 + 1];
+        for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+        {
+            snprintf(uuid + i * 2, 3, "%02x", properties.pipelineCacheUUID[i]);
+        }
+
+        filePath = directory + "/shade_pipeline_cache_" + uuid + "_" +
+                   std::to_string(properties.driverVersion) + ".bin";
+    }
+
+    std::vector<char> initialData = readCacheFile(properties);
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.pNext = nullptr;
+    createInfo.flags = 0;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+        // Drivers may still reject data that passed the header check, retry empty
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+
+        if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Shade: Failed to create pipeline cache!");
+        }
+    }
+}
+
+PipelineCache::~PipelineCache() { vkDestroyPipelineCache(device, pipelineCache, nullptr); }
+
+std::vector<char> PipelineCache::readCacheFile(const VkPhysicalDeviceProperties &properties)
+{
+    if (filePath.empty())
+    {
+        return {};
+    }
+
+    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        // First run on this device/driver
+        return {};
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> data(fileSize);
+
+    file.seekg(0);
+    file.read(data.data(), fileSize);
+
+    file.close();
+
+    if (!isCacheDataCompatible(data, properties))
+    {
+        return {};
+    }
+
+    return data;
+}
+
+bool PipelineCache::isCacheDataCompatible(const std::vector<char> &data,
+                                          const VkPhysicalDeviceProperties &properties)
+{
+    if (data.size() < cacheHeaderSize)
+    {
+        return false;
+    }
+
+    // Header: length, version, vendor ID, device ID, pipeline cache UUID
+    uint32_t header[4];
+    memcpy(header, data.data(), sizeof(header));
+
+    return header[0] >= cacheHeaderSize && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header[2] == properties.vendorID && header[3] == properties.deviceID &&
+           memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save()
+{
+    if (filePath.empty())
+    {
+        return;
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS ||
+        dataSize == 0)
+    {
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    // Write to a temporary file first so an interrupted save can't leave a
+    //  truncated cache behind
+    std::string tempPath = filePath + ".tmp";
+
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        std::cout << "Shade: (Warning) Failed to write pipeline cache '" << filePath << "'"
+                  << std::endl;
+        return;
+    }
+
+    file.write(data.data(), dataSize);
+    file.close();
+
+    std::remove(filePath.c_str());
+    if (std::rename(tempPath.c_str(), filePath.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        std::cout << "Shade: (Warning) Failed to write pipeline cache '" << filePath << "'"
+                  << std::endl;
+    }
+}
+
+std::string PipelineCache::getFilePath() { return filePath; }
+
+VkPipelineCache PipelineCache::_getVkPipelineCache() { return pipelineCache; }
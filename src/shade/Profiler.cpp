@@ -0,0 +1,140 @@
+#include "shade/Profiler.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace Shade;
+
+static const std::chrono::steady_clock::time_point profilerStart =
+    std::chrono::steady_clock::now();
+
+// Thread buffers are never freed, so events of finished threads can still be
+//  exported
+static std::mutex threadBuffersMutex;
+static std::vector<std::unique_ptr<ProfilerThreadBuffer>> threadBuffers;
+
+uint64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                profilerStart)
+        .count();
+}
+
+ProfilerThreadBuffer *Profiler::_getThreadBuffer()
+{
+    thread_local ProfilerThreadBuffer *threadBuffer = nullptr;
+
+    if (threadBuffer == nullptr)
+    {
+        // Only taken once per thread
+        std::lock_guard<std::mutex> lock(threadBuffersMutex);
+
+        threadBuffers.emplace_back(new ProfilerThreadBuffer());
+        threadBuffer = threadBuffers.back().get();
+        threadBuffer->threadId = static_cast<uint32_t>(threadBuffers.size());
+        threadBuffer->writeCount = 0;
+    }
+
+    return threadBuffer;
+}
+
+void Profiler::record(const char *name, uint64_t startNs, uint64_t endNs)
+{
+    ProfilerThreadBuffer *buffer = _getThreadBuffer();
+
+    uint64_t index = buffer->writeCount.load(std::memory_order_relaxed);
+
+    ProfilerEvent &event = buffer->events[index % ProfilerThreadBuffer::CAPACITY];
+    event.name = name;
+    event.startNs = startNs;
+    event.endNs = endNs;
+
+    // Publish the event to exporting threads
+    buffer->writeCount.store(index + 1, std::memory_order_release);
+}
+
+static void writeJsonString(std::ofstream &file, const char *str)
+{
+    file << '"';
+    for (const char *c = str; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            file << '\\';
+        }
+        file << *c;
+    }
+    file << '"';
+}
+
+void Profiler::exportChromeTrace(const std::string &path)
+{
+    std::ofstream file(path, std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Shade: Failed to open profiler trace file!");
+    }
+
+    // Avoid scientific notation in timestamps
+    file << std::fixed << std::setprecision(3);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool firstEvent = true;
+
+    std::lock_guard<std::mutex> lock(threadBuffersMutex);
+    for (const auto &buffer : threadBuffers)
+    {
+        uint64_t writeCount = buffer->writeCount.load(std::memory_order_acquire);
+        // Older events have been overwritten
+        uint64_t firstIndex = 0;
+        if (writeCount > ProfilerThreadBuffer::CAPACITY)
+        {
+            firstIndex = writeCount - ProfilerThreadBuffer::CAPACITY;
+        }
+
+        for (uint64_t i = firstIndex; i < writeCount; i++)
+        {
+            const ProfilerEvent &event = buffer->events[i % ProfilerThreadBuffer::CAPACITY];
+
+            if (!firstEvent)
+            {
+                file << ",";
+            }
+            firstEvent = false;
+
+            // Complete events ("X") with microsecond timestamps
+            file << "\n{\"name\":";
+            writeJsonString(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"ts\":" << event.startNs / 1000.0
+                 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+        }
+    }
+
+    file << "\n]}\n";
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(threadBuffersMutex);
+    for (const auto &buffer : threadBuffers)
+    {
+        buffer->writeCount.store(0, std::memory_order_release);
+    }
+}
+
+bool Profiler::isEnabled()
+{
+#ifdef SHADE_ENABLE_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,54 @@
+#include "shade/RenderCounters.hpp"
+
+using namespace Shade;
+
+RenderCounters &RenderCounters::operator+=(const RenderCounters &other)
+{
+    drawCalls += other.drawCalls;
+    indicesSubmitted += other.indicesSubmitted;
+
+    pipelineBinds += other.pipelineBinds;
+    descriptorSetBinds += other.descriptorSetBinds;
+    vertexBufferBinds += other.vertexBufferBinds;
+    indexBufferBinds += other.indexBufferBinds;
+
+    bufferUploads += other.bufferUploads;
+    bytesUploaded += other.bytesUploaded;
+    bytesStaged += other.bytesStaged;
+
+    singleTimeCommandStalls += other.singleTimeCommandStalls;
+
+    descriptorSetsAllocated += other.descriptorSetsAllocated;
+    pipelinesCreated += other.pipelinesCreated;
+
+    return *this;
+}
+
+static uint64_t collectCounter(std::atomic<uint64_t> &counter)
+{
+    return counter.exchange(0, std::memory_order_relaxed);
+}
+
+RenderCounters AtomicRenderCounters::collect()
+{
+    RenderCounters counters;
+
+    counters.drawCalls = collectCounter(drawCalls);
+    counters.indicesSubmitted = collectCounter(indicesSubmitted);
+
+    counters.pipelineBinds = collectCounter(pipelineBinds);
+    counters.descriptorSetBinds = collectCounter(descriptorSetBinds);
+    counters.vertexBufferBinds = collectCounter(vertexBufferBinds);
+    counters.indexBufferBinds = collectCounter(indexBufferBinds);
+
+    counters.bufferUploads = collectCounter(bufferUploads);
+    counters.bytesUploaded = collectCounter(bytesUploaded);
+    counters.bytesStaged = collectCounter(bytesStaged);
+
+    counters.singleTimeCommandStalls = collectCounter(singleTimeCommandStalls);
+
+    counters.descriptorSetsAllocated = collectCounter(descriptorSetsAllocated);
+    counters.pipelinesCreated = collectCounter(pipelinesCreated);
+
+    return counters;
+}
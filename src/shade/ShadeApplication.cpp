@@ -5,20 +5,40 @@
 #include <iostream>
 #include <set>
 
+#include "shade/Profiler.hpp"
+
 #define VMA_IMPLEMENTATION
 #include "shade/vendor/vk_mem_alloc.hpp"
 
 using namespace Shade;
 
-ShadeApplication::ShadeApplication() : VulkanApplication() {}
+ShadeApplication::ShadeApplication() : VulkanApplication()
+{
+    // Counters are written from the moment Vulkan objects are created
+    vulkanData.renderCounters = &renderCounters;
+}
 
 ShadeApplication::~ShadeApplication()
 {
+    // Cancel outstanding loads while the worker threads are still running,
+    //  and before the objects their textures are registered with are freed
+    delete vulkanData.textureLoader;
+
     // Clean up internal variables
-    vkDestroyDescriptorPool(vulkanData.device, vulkanData.descriptorPool, nullptr);
+    delete vulkanData.mipDownsampler;
+    delete vulkanData.descriptorAllocator;
+    delete vulkanData.bindlessTextures;
+
+    // Finish any background compilation before the cache is saved
+    delete vulkanData.threadPool;
 
-    vkDestroySemaphore(vulkanData.device, vulkanData.imageAvailableSemaphore, nullptr);
-    vkDestroySemaphore(vulkanData.device, vulkanData.renderFinishedSemaphore, nullptr);
+    delete gpuProfiler;
+
+    // Keep compiled pipelines for the next run
+    vulkanData.pipelineCache->save();
+    delete vulkanData.pipelineCache;
+
+    cleanupSyncObjects();
 
     cleanupDepthResources();
 
@@ -38,6 +58,9 @@ ShadeApplication::~ShadeApplication()
 
     vkDestroySwapchainKHR(vulkanData.device, vulkanData.swapChain, nullptr);
 
+    delete vulkanData.defragmenter;
+    delete vulkanData.memoryStatistics;
+
     vmaDestroyAllocator(vulkanData.allocator);
 
     vkDestroyDevice(vulkanData.device, nullptr);
@@ -72,23 +95,66 @@ void ShadeApplication::start(int argc, char **argv)
     running = true;
     while (!glfwWindowShouldClose(window) && running)
     {
-        glfwPollEvents();
+        SHADE_PROFILE_ZONE("Frame");
+
+        {
+            SHADE_PROFILE_ZONE("PollEvents");
+            glfwPollEvents();
+        }
 
-        // Update mouse data
-        updateMouseData();
+        {
+            // Update mouse data
+            SHADE_PROFILE_ZONE("UpdateMouseData");
+            updateMouseData();
+        }
 
-        // Update frame data (fixed delta time etc.)
-        updateFrameData();
-        this->update();
+        {
+            // Update frame data (fixed delta time etc.)
+            SHADE_PROFILE_ZONE("UpdateFrameData");
+            updateFrameData();
+        }
+
+        {
+            // Updates write buffers and descriptor sets directly, so the frame
+            //  last recorded in this slot must have finished first
+            SHADE_PROFILE_ZONE("WaitForFrame");
+            waitForFrameSlot();
+        }
 
-        this->renderStart();
-        this->render();
-        this->renderPresent();
+        {
+            SHADE_PROFILE_ZONE("Update");
+            this->update();
+        }
+
+        bool frameStarted;
+        {
+            SHADE_PROFILE_ZONE("RenderStart");
+            frameStarted = this->renderStart();
+        }
+
+        // Frames are skipped while the swapchain can't be recreated (minimised)
+        if (frameStarted)
+        {
+            {
+                SHADE_PROFILE_ZONE("Render");
+                this->render();
+            }
+
+            {
+                SHADE_PROFILE_ZONE("RenderPresent");
+                this->renderPresent();
+            }
+        }
     }
 
     // Wait until all operations on GPU are complete
     vkDeviceWaitIdle(vulkanData.device);
 
+    if (info.printFrameStatisticsOnExit)
+    {
+        frameStatistics.dump(std::cout);
+    }
+
     this->destroy();
 }
 
@@ -158,15 +224,23 @@ void ShadeApplication::initVulkan()
     pickPhysicalDevice();
     createLogicalDevice();
     createAllocator();
+    createMemoryStatistics();
+    createDefragmenter();
     createSwapchain();
     createImageViews();
     createCommandPool();
     createDepthResources();
     createRenderPass();
     createFramebuffers();
-    createSemaphores();
+    createSyncObjects();
     createCommandBuffers();
-    createDescriptorPool();
+    createDescriptorAllocator();
+    createBindlessTextureRegistry();
+    createPipelineCache();
+    createMipDownsampler();
+    createThreadPool();
+    createTextureLoader();
+    createGpuProfiler();
 }
 
 void ShadeApplication::createInstance()
@@ -182,7 +256,21 @@ void ShadeApplication::createInstance()
     applicationInfo.pApplicationName = "Shade Application";
     applicationInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 
-    applicationInfo.apiVersion = VK_API_VERSION_1_0;
+    // Use Vulkan 1.1 when the loader supports it, Shade doesn't need anything newer
+    vulkanData.apiVersion = VK_API_VERSION_1_0;
+
+    auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(
+        VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+
+    uint32_t instanceVersion;
+    if (enumerateInstanceVersion != nullptr &&
+        enumerateInstanceVersion(&instanceVersion) == VK_SUCCESS &&
+        instanceVersion >= VK_API_VERSION_1_1)
+    {
+        vulkanData.apiVersion = VK_API_VERSION_1_1;
+    }
+
+    applicationInfo.apiVersion = vulkanData.apiVersion;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -249,6 +337,12 @@ void ShadeApplication::pickPhysicalDevice()
             vkGetPhysicalDeviceProperties(tDevice, &deviceProperties);
             vulkanData.physicalDeviceProperties = deviceProperties;
 
+            // Fall back to 1.0 features when the device doesn't support 1.1
+            if (deviceProperties.apiVersion < VK_API_VERSION_1_1)
+            {
+                vulkanData.apiVersion = VK_API_VERSION_1_0;
+            }
+
             break;
         }
     }
@@ -269,7 +363,7 @@ bool ShadeApplication::isDeviceSuitable(VkPhysicalDevice device)
 
     QueueFamilyIndices indices = findQueueFamilies(device);
 
-    bool extensionsSupported = checkDeviceExtensionsSupport(device);
+    bool extensionsSupported = checkDeviceExtensionsSupport(device, deviceExtensions);
 
     bool swapChainAdequate = false;
     if (extensionsSupported)
@@ -280,8 +374,10 @@ bool ShadeApplication::isDeviceSuitable(VkPhysicalDevice device)
             !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
 
+    bool bindlessSupported = !info.bindlessTextures || checkBindlessTextureSupport(device);
+
     return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-           supportedFeatures.samplerAnisotropy;
+           supportedFeatures.samplerAnisotropy && bindlessSupported;
 }
 
 QueueFamilyIndices ShadeApplication::findQueueFamilies(VkPhysicalDevice device)
@@ -320,7 +416,8 @@ QueueFamilyIndices ShadeApplication::findQueueFamilies(VkPhysicalDevice device)
     return indices;
 }
 
-bool ShadeApplication::checkDeviceExtensionsSupport(VkPhysicalDevice device)
+bool ShadeApplication::checkDeviceExtensionsSupport(VkPhysicalDevice device,
+                                                    const std::vector<const char *> &extensions)
 {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -330,7 +427,7 @@ bool ShadeApplication::checkDeviceExtensionsSupport(VkPhysicalDevice device)
                                          availableExtensions.data());
 
     // Create set from device extensions
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     // Erase extensions that are available
     for (const auto &extension : availableExtensions)
@@ -341,6 +438,39 @@ bool ShadeApplication::checkDeviceExtensionsSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool ShadeApplication::checkBindlessTextureSupport(VkPhysicalDevice device)
+{
+    // Feature queries through VkPhysicalDeviceFeatures2 need Vulkan 1.1
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+    if (vulkanData.apiVersion < VK_API_VERSION_1_1 ||
+        deviceProperties.apiVersion < VK_API_VERSION_1_1)
+    {
+        return false;
+    }
+
+    if (!checkDeviceExtensionsSupport(device, bindlessDeviceExtensions))
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &indexingFeatures;
+
+    vkGetPhysicalDeviceFeatures2(device, &features);
+
+    return indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+           indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+           indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+           indexingFeatures.descriptorBindingPartiallyBound &&
+           indexingFeatures.runtimeDescriptorArray;
+}
+
 SwapChainSupportDetails ShadeApplication::querySwapChainSupport(VkPhysicalDevice device)
 {
     SwapChainSupportDetails details;
@@ -377,6 +507,18 @@ void ShadeApplication::createLogicalDevice()
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // Block-compressed textures are used when available, not required
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(vulkanData.physicalDevice, &supportedFeatures);
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    vulkanData.textureCompressionBC = supportedFeatures.textureCompressionBC == VK_TRUE;
+
+    // Compute mip generation is likewise optional
+    deviceFeatures.shaderStorageImageWriteWithoutFormat =
+        supportedFeatures.shaderStorageImageWriteWithoutFormat;
+    vulkanData.storageImageWriteWithoutFormat =
+        supportedFeatures.shaderStorageImageWriteWithoutFormat == VK_TRUE;
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.pNext = nullptr;
@@ -409,8 +551,46 @@ void ShadeApplication::createLogicalDevice()
 
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char *> enabledExtensions = deviceExtensions;
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    VkPhysicalDeviceFeatures2 features = {};
+
+    if (info.bindlessTextures)
+    {
+        enabledExtensions.insert(enabledExtensions.end(), bindlessDeviceExtensions.begin(),
+                                 bindlessDeviceExtensions.end());
+
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+
+        // Extension features are enabled through the pNext chain instead
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        features.features = deviceFeatures;
+
+        createInfo.pNext = &features;
+        createInfo.pEnabledFeatures = nullptr;
+    }
+
+    // Let VMA report the driver's memory budget instead of estimating it from
+    //  the heap sizes (VMA queries it through Vulkan 1.1 functions)
+    vulkanData.memoryBudgetSupported =
+        vulkanData.apiVersion >= VK_API_VERSION_1_1 &&
+        checkDeviceExtensionsSupport(vulkanData.physicalDevice,
+                                     {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME});
+
+    if (vulkanData.memoryBudgetSupported)
+    {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     if (_SHADE_ENABLE_VALIDATION_LAYERS)
     {
@@ -441,6 +621,13 @@ void ShadeApplication::createAllocator()
     VmaAllocatorCreateInfo createInfo = {};
     createInfo.physicalDevice = vulkanData.physicalDevice;
     createInfo.device = vulkanData.device;
+    createInfo.instance = vulkanData.instance;
+    createInfo.vulkanApiVersion = vulkanData.apiVersion;
+
+    if (vulkanData.memoryBudgetSupported)
+    {
+        createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
 
     vmaCreateAllocator(&createInfo, &vulkanData.allocator);
 
@@ -448,12 +635,35 @@ void ShadeApplication::createAllocator()
     vulkanData.allocationCallbacks = vulkanData.allocator->GetAllocationCallbacks();
 }
 
-void ShadeApplication::createSwapchain()
+void ShadeApplication::createMemoryStatistics()
+{
+    vulkanData.memoryStatistics =
+        new MemoryStatistics(&vulkanData, info.memoryBudgetWarningThreshold);
+}
+
+void ShadeApplication::createDefragmenter()
+{
+    vulkanData.defragmenter = nullptr;
+
+    if (info.defragmentation)
+    {
+        vulkanData.defragmenter = new Defragmenter(this, info.defragmentationMaxBytesPerPass,
+                                                   info.defragmentationMaxMovesPerPass);
+    }
+}
+
+void ShadeApplication::createSwapchain(VkSwapchainKHR oldSwapchain)
 {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(vulkanData.physicalDevice);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
 
+    if (info.swapchainImageCount > 0)
+    {
+        imageCount =
+            std::max(info.swapchainImageCount, swapChainSupport.capabilities.minImageCount);
+    }
+
     // Check that image count is not exceeding the maximum supported value
     if ((swapChainSupport.capabilities.maxImageCount > 0) &&
         imageCount > swapChainSupport.capabilities.maxImageCount)
@@ -502,7 +712,8 @@ void ShadeApplication::createSwapchain()
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // Lets the presentation engine retire the old swapchain's images gracefully
+    createInfo.oldSwapchain = oldSwapchain;
 
     if (vkCreateSwapchainKHR(vulkanData.device, &createInfo, nullptr, &vulkanData.swapChain) !=
         VK_SUCCESS)
@@ -547,14 +758,32 @@ VkExtent2D ShadeApplication::getOptimalSwapExtent(const VkSurfaceCapabilitiesKHR
 VkPresentModeKHR ShadeApplication::getOptimalSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes)
 {
+    VkPresentModeKHR requestedPresentMode;
+    switch (info.presentMode)
+    {
+    case PRESENT_MODE_FIFO_RELAXED:
+        requestedPresentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        break;
+    case PRESENT_MODE_MAILBOX:
+        requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+        break;
+    case PRESENT_MODE_IMMEDIATE:
+        requestedPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        break;
+    default:
+        requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+        break;
+    }
+
     for (const auto &availablePresentMode : availablePresentModes)
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+        if (availablePresentMode == requestedPresentMode)
         {
             return availablePresentMode;
         }
     }
 
+    // FIFO is the only mode guaranteed to be supported
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -697,18 +926,70 @@ void ShadeApplication::createFramebuffers()
     }
 }
 
-void ShadeApplication::createSemaphores()
+void ShadeApplication::createSyncObjects()
 {
+    uint32_t frameCount = std::max(info.maxFramesInFlight, 1u);
+
+    vulkanData.imageAvailableSemaphores.resize(frameCount);
+    vulkanData.renderFinishedSemaphores.resize(frameCount);
+    vulkanData.inFlightFences.resize(frameCount);
+    vulkanData.currentFrame = 0;
+
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    if ((vkCreateSemaphore(vulkanData.device, &semaphoreInfo, nullptr,
-                           &vulkanData.imageAvailableSemaphore) != VK_SUCCESS) |
-        (vkCreateSemaphore(vulkanData.device, &semaphoreInfo, nullptr,
-                           &vulkanData.renderFinishedSemaphore) != VK_SUCCESS))
+    // Fences start signalled so the first wait on each frame returns immediately
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    for (uint32_t i = 0; i < frameCount; i++)
     {
-        throw std::runtime_error("Shade: Failed to create semaphores!");
+        if ((vkCreateSemaphore(vulkanData.device, &semaphoreInfo, nullptr,
+                               &vulkanData.imageAvailableSemaphores[i]) != VK_SUCCESS) |
+            (vkCreateSemaphore(vulkanData.device, &semaphoreInfo, nullptr,
+                               &vulkanData.renderFinishedSemaphores[i]) != VK_SUCCESS))
+        {
+            throw std::runtime_error("Shade: Failed to create semaphores!");
+        }
+
+        if (vkCreateFence(vulkanData.device, &fenceInfo, nullptr,
+                          &vulkanData.inFlightFences[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Shade: Failed to create fences!");
+        }
     }
+
+    vulkanData.imagesInFlight.assign(vulkanData.swapChainImages.size(), VK_NULL_HANDLE);
+}
+
+void ShadeApplication::cleanupSyncObjects()
+{
+    for (size_t i = 0; i < vulkanData.inFlightFences.size(); i++)
+    {
+        vkDestroySemaphore(vulkanData.device, vulkanData.imageAvailableSemaphores[i], nullptr);
+        vkDestroySemaphore(vulkanData.device, vulkanData.renderFinishedSemaphores[i], nullptr);
+        vkDestroyFence(vulkanData.device, vulkanData.inFlightFences[i], nullptr);
+    }
+
+    vulkanData.imageAvailableSemaphores.clear();
+    vulkanData.renderFinishedSemaphores.clear();
+    vulkanData.inFlightFences.clear();
+    vulkanData.imagesInFlight.clear();
+}
+
+void ShadeApplication::waitForFramesInFlight()
+{
+    vkWaitForFences(vulkanData.device, static_cast<uint32_t>(vulkanData.inFlightFences.size()),
+                    vulkanData.inFlightFences.data(), VK_TRUE, UINT64_MAX);
+}
+
+void ShadeApplication::waitForFrameSlot()
+{
+    // Limits how far the CPU runs ahead; with one frame in flight this is the
+    //  previous frame, so nothing the GPU reads is written while in use
+    vkWaitForFences(vulkanData.device, 1, &vulkanData.inFlightFences[vulkanData.currentFrame],
+                    VK_TRUE, UINT64_MAX);
 }
 
 void ShadeApplication::createCommandPool()
@@ -744,21 +1025,76 @@ void ShadeApplication::createCommandBuffers()
     }
 }
 
-void ShadeApplication::createDescriptorPool()
+void ShadeApplication::createDescriptorAllocator()
 {
-    VkDescriptorPoolSize poolSizes[] = {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024},
-                                        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1024},
-                                        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024}};
+    // One set of transient pools per swapchain image
+    vulkanData.descriptorAllocator = new DescriptorAllocator(
+        vulkanData.device, static_cast<uint32_t>(vulkanData.swapChainImages.size()));
+}
 
-    VkDescriptorPoolCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    createInfo.pNext = nullptr;
-    createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    createInfo.maxSets = 2048; // PLACEHOLDER VALUE, research this
-    createInfo.poolSizeCount = 3;
-    createInfo.pPoolSizes = poolSizes;
+void ShadeApplication::createBindlessTextureRegistry()
+{
+    vulkanData.bindlessTextures = nullptr;
+
+    if (!info.bindlessTextures)
+    {
+        return;
+    }
+
+    // Clamp the array size to what the device allows in update-after-bind sets
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+    indexingProperties.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2 properties = {};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &indexingProperties;
+
+    vkGetPhysicalDeviceProperties2(vulkanData.physicalDevice, &properties);
+
+    uint32_t capacity =
+        std::min({info.maxBindlessTextures,
+                  indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                  indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                  indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                  indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    vulkanData.bindlessTextures = new BindlessTextureRegistry(
+        vulkanData.device, capacity, static_cast<uint32_t>(vulkanData.swapChainImages.size()));
+}
+
+void ShadeApplication::createPipelineCache()
+{
+    vulkanData.pipelineCache =
+        new PipelineCache(vulkanData.device, vulkanData.physicalDeviceProperties,
+                          info.pipelineCacheDirectory);
+}
+
+void ShadeApplication::createMipDownsampler()
+{
+    vulkanData.mipDownsampler = nullptr;
+    if (MipDownsampler::_isSupported(&vulkanData))
+    {
+        vulkanData.mipDownsampler = new MipDownsampler(this);
+    }
+}
 
-    vkCreateDescriptorPool(vulkanData.device, &createInfo, nullptr, &vulkanData.descriptorPool);
+void ShadeApplication::createThreadPool()
+{
+    vulkanData.threadPool = new ThreadPool(info.workerThreadCount);
+}
+
+void ShadeApplication::createTextureLoader()
+{
+    vulkanData.textureLoader = new TextureLoader(this, info.textureUploadBytesPerFrame);
+}
+
+void ShadeApplication::createGpuProfiler()
+{
+    if (info.gpuProfiling)
+    {
+        gpuProfiler = new GpuProfiler(&vulkanData, info.maxFramesInFlight);
+    }
 }
 
 void ShadeApplication::createDepthResources()
@@ -769,7 +1105,8 @@ void ShadeApplication::createDepthResources()
     _createImage(vulkanData.swapChainExtent.width, vulkanData.swapChainExtent.height,
                  vulkanData.depthImageFormat, VK_IMAGE_TILING_OPTIMAL,
                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                 vulkanData.depthImage, vulkanData.depthImageMemory);
+                 vulkanData.depthImage, vulkanData.depthImageAllocation, 1,
+                 MEMORY_CATEGORY_ATTACHMENT);
 
     _createImageView(vulkanData.depthImage, vulkanData.depthImageFormat, VK_IMAGE_ASPECT_DEPTH_BIT,
                      vulkanData.depthImageView);
@@ -782,23 +1119,59 @@ void ShadeApplication::createDepthResources()
 void ShadeApplication::framebufferResizeCallback(GLFWwindow *window, int width, int height)
 {
     ShadeApplication *app = (ShadeApplication *)glfwGetWindowUserPointer(window);
+
+    // Only record the new size; the swapchain is recreated once per frame
+    //  rather than for every intermediate size during a drag
     app->setWindowSize({0, 0, (float)width, (float)height});
 }
 
-void ShadeApplication::recreateSwapchain()
+bool ShadeApplication::recreateSwapchain()
 {
-    vkDeviceWaitIdle(vulkanData.device);
+    SHADE_PROFILE_FUNCTION();
+
+    // A minimised window has no drawable area, keep waiting for a real size.
+    //  Block until the next event rather than spinning the main loop
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    if (width == 0 || height == 0)
+    {
+        glfwWaitEvents();
+        return false;
+    }
+
+    swapchainOutOfDate = false;
+
+    // Wait for the frames still using the old swapchain's resources
+    waitForFramesInFlight();
 
     cleanupSwapchain();
 
-    createSwapchain();
+    VkFormat previousImageFormat = vulkanData.swapChainImageFormat;
+
+    VkSwapchainKHR oldSwapchain = vulkanData.swapChain;
+    createSwapchain(oldSwapchain);
+    vkDestroySwapchainKHR(vulkanData.device, oldSwapchain, nullptr);
+
     createImageViews();
-    createRenderPass();
 
-    // Update shaders
-    for (auto shader : shaderRegistry)
+    // Viewport and scissor are dynamic, so pipelines only need rebuilding when
+    //  the render pass changes, i.e. when the surface format does
+    if (vulkanData.swapChainImageFormat != previousImageFormat)
     {
-        shader->_recreateGraphicsPipeline();
+        // Background compilations may still reference the old render pass
+        for (auto shader : shaderRegistry)
+        {
+            shader->_waitForPipeline();
+        }
+
+        vkDestroyRenderPass(vulkanData.device, vulkanData.renderPass, nullptr);
+        createRenderPass();
+
+        // Update shaders
+        for (auto shader : shaderRegistry)
+        {
+            shader->_recreateGraphicsPipeline();
+        }
     }
 
     cleanupDepthResources();
@@ -806,6 +1179,17 @@ void ShadeApplication::recreateSwapchain()
 
     createFramebuffers();
     createCommandBuffers();
+
+    // Image count may have changed, every frame has finished
+    uint32_t imageCount = static_cast<uint32_t>(vulkanData.swapChainImages.size());
+    vulkanData.imagesInFlight.assign(imageCount, VK_NULL_HANDLE);
+    vulkanData.descriptorAllocator->setFrameCount(imageCount);
+    if (vulkanData.bindlessTextures != nullptr)
+    {
+        vulkanData.bindlessTextures->setFrameCount(imageCount);
+    }
+
+    return true;
 }
 
 void ShadeApplication::cleanupSwapchain()
@@ -819,29 +1203,94 @@ void ShadeApplication::cleanupSwapchain()
                          static_cast<uint32_t>(vulkanData.commandBuffers.size()),
                          vulkanData.commandBuffers.data());
 
-    vkDestroyRenderPass(vulkanData.device, vulkanData.renderPass, nullptr);
-
     for (size_t i = 0; i < vulkanData.swapChainImageViews.size(); i++)
     {
         vkDestroyImageView(vulkanData.device, vulkanData.swapChainImageViews[i], nullptr);
     }
-
-    vkDestroySwapchainKHR(vulkanData.device, vulkanData.swapChain, nullptr);
 }
 
 void ShadeApplication::cleanupDepthResources()
 {
-    vkDestroyImage(vulkanData.device, vulkanData.depthImage, nullptr);
     vkDestroyImageView(vulkanData.device, vulkanData.depthImageView, nullptr);
-    vkFreeMemory(vulkanData.device, vulkanData.depthImageMemory, nullptr);
+    _destroyImage(vulkanData.depthImage, vulkanData.depthImageAllocation,
+                  MEMORY_CATEGORY_ATTACHMENT);
 }
 
-void ShadeApplication::renderStart()
+bool ShadeApplication::renderStart()
 {
+    if (syncObjectsOutOfDate)
+    {
+        waitForFramesInFlight();
+        cleanupSyncObjects();
+        createSyncObjects();
+        syncObjectsOutOfDate = false;
+
+        if (gpuProfiler != nullptr)
+        {
+            gpuProfiler->setFrameCount(info.maxFramesInFlight);
+        }
+    }
+
+    if (swapchainOutOfDate && !recreateSwapchain())
+    {
+        return false;
+    }
+
+    // Defragment while no textures are loading, so passes don't compete with
+    //  uploads for memory; passes only wait for the GPU when they move something
+    if (vulkanData.defragmenter != nullptr &&
+        ++framesSinceDefragmentation >= info.defragmentationInterval &&
+        vulkanData.textureLoader->getPendingCount() == 0)
+    {
+        vulkanData.defragmenter->runPass();
+        framesSinceDefragmentation = 0;
+    }
+
+    // Upload textures decoded in the background
+    vulkanData.textureLoader->_processUploads();
+
+    // Refreshes the memory budget and warns when a heap is close to it
+    vulkanData.memoryStatistics->beginFrame();
+
+    // This frame slot's previous submission was waited on before update()
+    VkFence frameFence = vulkanData.inFlightFences[vulkanData.currentFrame];
+
     // Get current image index
-    vkAcquireNextImageKHR(vulkanData.device, vulkanData.swapChain, UINT64_MAX,
-                          vulkanData.imageAvailableSemaphore, nullptr,
-                          &vulkanData.currentImageIndex);
+    VkResult result = vkAcquireNextImageKHR(
+        vulkanData.device, vulkanData.swapChain, UINT64_MAX,
+        vulkanData.imageAvailableSemaphores[vulkanData.currentFrame], VK_NULL_HANDLE,
+        &vulkanData.currentImageIndex);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
+    {
+        // No image was acquired, try again next frame with a new swapchain
+        swapchainOutOfDate = true;
+        return false;
+    }
+    else if (result == VK_SUBOPTIMAL_KHR)
+    {
+        // Image is still presentable, recreate after this frame
+        swapchainOutOfDate = true;
+    }
+    else if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to acquire swap chain image!");
+    }
+
+    // Images can be acquired out of order, wait for the frame that last used this one
+    VkFence imageFence = vulkanData.imagesInFlight[vulkanData.currentImageIndex];
+    if (imageFence != VK_NULL_HANDLE && imageFence != frameFence)
+    {
+        vkWaitForFences(vulkanData.device, 1, &imageFence, VK_TRUE, UINT64_MAX);
+    }
+    vulkanData.imagesInFlight[vulkanData.currentImageIndex] = frameFence;
+
+    // The previous submission of this image has finished, release its transient sets
+    vulkanData.descriptorAllocator->beginFrame(vulkanData.currentImageIndex);
+    if (vulkanData.bindlessTextures != nullptr)
+    {
+        vulkanData.bindlessTextures->beginFrame(vulkanData.currentImageIndex);
+    }
 
     // Reset command buffer
     vkResetCommandBuffer(vulkanData.commandBuffers[vulkanData.currentImageIndex],
@@ -859,6 +1308,19 @@ void ShadeApplication::renderStart()
         throw std::runtime_error("Shade: Failed to begin recording command buffer!");
     }
 
+    // Nothing is bound in a freshly started command buffer
+    boundState = {};
+
+    if (gpuProfiler != nullptr)
+    {
+        // Collects this slot's previous results; the query reset must be
+        //  recorded outside of the render pass
+        gpuProfiler->beginFrame(vulkanData.commandBuffers[vulkanData.currentImageIndex],
+                                vulkanData.currentFrame);
+        gpuProfiler->beginScope(vulkanData.commandBuffers[vulkanData.currentImageIndex], "Frame");
+    }
+    drawIndex = 0;
+
     VkRenderPassBeginInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = vulkanData.renderPass;
@@ -877,6 +1339,24 @@ void ShadeApplication::renderStart()
     // Begin render pass
     vkCmdBeginRenderPass(vulkanData.commandBuffers[vulkanData.currentImageIndex], &renderPassInfo,
                          VK_SUBPASS_CONTENTS_INLINE);
+
+    // Cover the whole swapchain image (dynamic state shared by all pipelines)
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)vulkanData.swapChainExtent.width;
+    viewport.height = (float)vulkanData.swapChainExtent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor = {};
+    scissor.offset = {0, 0};
+    scissor.extent = vulkanData.swapChainExtent;
+
+    vkCmdSetViewport(vulkanData.commandBuffers[vulkanData.currentImageIndex], 0, 1, &viewport);
+    vkCmdSetScissor(vulkanData.commandBuffers[vulkanData.currentImageIndex], 0, 1, &scissor);
+
+    return true;
 }
 
 void ShadeApplication::renderPresent()
@@ -884,6 +1364,11 @@ void ShadeApplication::renderPresent()
     // End render pass
     vkCmdEndRenderPass(vulkanData.commandBuffers[vulkanData.currentImageIndex]);
 
+    if (gpuProfiler != nullptr)
+    {
+        gpuProfiler->endScope(vulkanData.commandBuffers[vulkanData.currentImageIndex]);
+    }
+
     if (vkEndCommandBuffer(vulkanData.commandBuffers[vulkanData.currentImageIndex]) != VK_SUCCESS)
     {
         throw std::runtime_error("Shade: Failed to record command buffer!");
@@ -892,7 +1377,7 @@ void ShadeApplication::renderPresent()
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = {vulkanData.imageAvailableSemaphore};
+    VkSemaphore waitSemaphores[] = {vulkanData.imageAvailableSemaphores[vulkanData.currentFrame]};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
     submitInfo.waitSemaphoreCount = 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
@@ -900,11 +1385,16 @@ void ShadeApplication::renderPresent()
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &vulkanData.commandBuffers[vulkanData.currentImageIndex];
 
-    VkSemaphore signalSemaphores[] = {vulkanData.renderFinishedSemaphore};
+    VkSemaphore signalSemaphores[] = {vulkanData.renderFinishedSemaphores[vulkanData.currentFrame]};
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(vulkanData.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    // Reset only once work is certain to be submitted, so the fence can't be
+    //  left unsignalled by a skipped frame
+    VkFence frameFence = vulkanData.inFlightFences[vulkanData.currentFrame];
+    vkResetFences(vulkanData.device, 1, &frameFence);
+
+    if (vkQueueSubmit(vulkanData.graphicsQueue, 1, &submitInfo, frameFence) != VK_SUCCESS)
     {
         throw std::runtime_error("Shade: Failed to submit draw command buffer!");
     }
@@ -921,12 +1411,31 @@ void ShadeApplication::renderPresent()
     presentInfo.pImageIndices = &vulkanData.currentImageIndex;
     presentInfo.pResults = nullptr;
 
-    vkQueuePresentKHR(vulkanData.presentQueue, &presentInfo);
+    VkResult result = vkQueuePresentKHR(vulkanData.presentQueue, &presentInfo);
+
+    double presentTime = glfwGetTime();
+    if (prevPresentTime > 0)
+    {
+        presentInterval = presentTime - prevPresentTime;
 
-    // Prevent CPU from submitting work faster than GPU
-    //  can keep up with.
-    // Wait for present operations to be finished.
-    vkQueueWaitIdle(vulkanData.presentQueue);
+        // Exponential moving average, roughly covering the last 20 frames
+        averagePresentInterval = averagePresentInterval == 0
+                                     ? presentInterval
+                                     : averagePresentInterval * 0.95 + presentInterval * 0.05;
+    }
+    prevPresentTime = presentTime;
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+    {
+        swapchainOutOfDate = true;
+    }
+    else if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to present swap chain image!");
+    }
+
+    vulkanData.currentFrame =
+        (vulkanData.currentFrame + 1) % static_cast<uint32_t>(vulkanData.inFlightFences.size());
 }
 
 void ShadeApplication::setRenderClearColour(Colour c) { this->info.clearColour = c; }
@@ -936,7 +1445,7 @@ void ShadeApplication::setWindowSize(Rect windowSize)
     if ((windowSize.height > 1) | (windowSize.width > 1))
     {
         info.windowSize = windowSize;
-        this->recreateSwapchain();
+        swapchainOutOfDate = true;
     }
 }
 
@@ -967,39 +1476,146 @@ void ShadeApplication::setMouseLock(bool mouseLock)
 
 bool ShadeApplication::getMouseLock() { return this->info.mouseLock; }
 
-void ShadeApplication::renderMesh(Mesh *mesh, Material *material)
+void ShadeApplication::setPresentMode(PresentMode presentMode)
+{
+    info.presentMode = presentMode;
+    swapchainOutOfDate = true;
+}
+
+PresentMode ShadeApplication::getPresentMode() { return this->info.presentMode; }
+
+void ShadeApplication::setSwapchainImageCount(uint32_t imageCount)
+{
+    info.swapchainImageCount = imageCount;
+    swapchainOutOfDate = true;
+}
+
+uint32_t ShadeApplication::getSwapchainImageCount()
+{
+    return static_cast<uint32_t>(vulkanData.swapChainImages.size());
+}
+
+void ShadeApplication::setMaxFramesInFlight(uint32_t maxFramesInFlight)
+{
+    info.maxFramesInFlight = std::max(maxFramesInFlight, 1u);
+    syncObjectsOutOfDate = true;
+}
+
+uint32_t ShadeApplication::getMaxFramesInFlight() { return this->info.maxFramesInFlight; }
+
+float ShadeApplication::getPresentInterval() { return (float)presentInterval; }
+
+float ShadeApplication::getAveragePresentInterval() { return (float)averagePresentInterval; }
+
+void ShadeApplication::renderMesh(Mesh *mesh, Material *material, void *pushConstantData)
 {
-    renderTriangles(mesh->getVertexBuffer(), mesh->getIndexBuffer(), material);
+    renderTriangles(mesh->getVertexBuffer(), mesh->getIndexBuffer(), material, 0,
+                    pushConstantData);
 }
 
 void ShadeApplication::renderTriangles(VertexBuffer *vertexBuffer, IndexBuffer *indexBuffer,
-                                       Material *material, int indexBufferOffset)
+                                       Material *material, int indexBufferOffset,
+                                       void *pushConstantData)
 {
-    // Bind shader graphics pipeline
-    vkCmdBindPipeline(vulkanData.commandBuffers[vulkanData.currentImageIndex],
-                      VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      material->getShader()->_getGraphicsPipeline());
+    VkCommandBuffer commandBuffer = vulkanData.commandBuffers[vulkanData.currentImageIndex];
+    Shader *shader = material->getShader();
 
-    vkCmdBindIndexBuffer(vulkanData.commandBuffers[vulkanData.currentImageIndex],
-                         indexBuffer->_getVkBuffer(), indexBufferOffset, VK_INDEX_TYPE_UINT32);
+    if (!shader->isReady())
+    {
+        // Draw with the fallback until the pipeline has compiled
+        shader = shader->getFallbackShader();
 
-    VkBuffer vertexBuffers[] = {vertexBuffer->_getVkBuffer()};
-    VkDeviceSize vertexBufferOffsets[] = {0};
-    vkCmdBindVertexBuffers(vulkanData.commandBuffers[vulkanData.currentImageIndex], 0, 1,
-                           vertexBuffers, vertexBufferOffsets);
+        if (shader == nullptr || !shader->isReady())
+        {
+            return;
+        }
+    }
+
+    // Only rebind state that differs from the previous draw, so draws sorted by
+    //  pipeline (and using bindless textures) bind little more than push constants
+    VkPipeline pipeline = shader->_getGraphicsPipeline();
+    if (pipeline != boundState.pipeline)
+    {
+        // Bind shader graphics pipeline
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        boundState.pipeline = pipeline;
+        AtomicRenderCounters::add(renderCounters.pipelineBinds);
+    }
+
+    VkPipelineLayout pipelineLayout = shader->_getGraphicsPipelineLayout();
+    bool pipelineLayoutChanged = pipelineLayout != boundState.pipelineLayout;
+    boundState.pipelineLayout = pipelineLayout;
+
+    if (indexBuffer->_getVkBuffer() != boundState.indexBuffer ||
+        indexBufferOffset != boundState.indexBufferOffset)
+    {
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->_getVkBuffer(), indexBufferOffset,
+                             VK_INDEX_TYPE_UINT32);
+        boundState.indexBuffer = indexBuffer->_getVkBuffer();
+        boundState.indexBufferOffset = indexBufferOffset;
+        AtomicRenderCounters::add(renderCounters.indexBufferBinds);
+    }
+
+    if (vertexBuffer->_getVkBuffer() != boundState.vertexBuffer)
+    {
+        VkBuffer vertexBuffers[] = {vertexBuffer->_getVkBuffer()};
+        VkDeviceSize vertexBufferOffsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, vertexBufferOffsets);
+        boundState.vertexBuffer = vertexBuffer->_getVkBuffer();
+        AtomicRenderCounters::add(renderCounters.vertexBufferBinds);
+    }
 
     VkDescriptorSet descriptorSet = material->_getDescriptorSet();
 
-    // Get dynamic uniform offsets
-    std::vector<uint32_t> dynamicUniformOffsets = material->_getVkDynamicUniformOffsets();
+    if (descriptorSet != VK_NULL_HANDLE)
+    {
+        // Get dynamic uniform offsets
+        std::vector<uint32_t> dynamicUniformOffsets = material->_getVkDynamicUniformOffsets();
+
+        if (pipelineLayoutChanged || descriptorSet != boundState.descriptorSet ||
+            dynamicUniformOffsets != boundState.dynamicUniformOffsets)
+        {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    pipelineLayout, 0, 1, &descriptorSet,
+                                    dynamicUniformOffsets.size(), dynamicUniformOffsets.data());
 
-    vkCmdBindDescriptorSets(
-        vulkanData.commandBuffers[vulkanData.currentImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
-        material->getShader()->_getGraphicsPipelineLayout(), 0, 1, &descriptorSet,
-        dynamicUniformOffsets.size(), dynamicUniformOffsets.data());
+            boundState.descriptorSet = descriptorSet;
+            boundState.dynamicUniformOffsets = dynamicUniformOffsets;
+            AtomicRenderCounters::add(renderCounters.descriptorSetBinds);
+        }
+    }
 
-    vkCmdDrawIndexed(vulkanData.commandBuffers[vulkanData.currentImageIndex],
-                     indexBuffer->getElementCount(), 1, 0, 0, 0);
+    if (pipelineLayoutChanged && shader->_usesBindlessTextures())
+    {
+        // Global texture array stays bound until the pipeline layout changes
+        VkDescriptorSet bindlessSet = vulkanData.bindlessTextures->_getDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                                BindlessTextureRegistry::DESCRIPTOR_SET_INDEX, 1, &bindlessSet, 0,
+                                nullptr);
+        AtomicRenderCounters::add(renderCounters.descriptorSetBinds);
+    }
+
+    if (pushConstantData != nullptr)
+    {
+        // Record per-draw data straight into the command buffer
+        shader->_pushConstants(commandBuffer, pushConstantData);
+    }
+
+    bool profileDraw = gpuProfiler != nullptr && info.gpuProfileDraws;
+    if (profileDraw)
+    {
+        gpuProfiler->beginScope(commandBuffer, "Draw " + std::to_string(drawIndex));
+    }
+
+    vkCmdDrawIndexed(commandBuffer, indexBuffer->getElementCount(), 1, 0, 0, 0);
+    AtomicRenderCounters::add(renderCounters.drawCalls);
+    AtomicRenderCounters::add(renderCounters.indicesSubmitted, indexBuffer->getElementCount());
+
+    if (profileDraw)
+    {
+        gpuProfiler->endScope(commandBuffer);
+    }
+    drawIndex++;
 }
 
 ShadeApplicationInfo *ShadeApplication::_getApplicationInfo() { return &this->info; }
@@ -1066,13 +1682,56 @@ Mouse ShadeApplication::getMouse() { return this->mouseData; }
 
 GLFWwindow *ShadeApplication::_getGLFWWindow() { return this->window; }
 
+GpuProfiler *ShadeApplication::getGpuProfiler() { return gpuProfiler; }
+
+MemoryStatistics *ShadeApplication::getMemoryStatistics() { return vulkanData.memoryStatistics; }
+
+Defragmenter *ShadeApplication::getDefragmenter() { return vulkanData.defragmenter; }
+
+TextureLoader *ShadeApplication::getTextureLoader() { return vulkanData.textureLoader; }
+
+MipDownsampler *ShadeApplication::getMipDownsampler() { return vulkanData.mipDownsampler; }
+
+void ShadeApplication::beginGpuScope(const std::string &name)
+{
+    if (gpuProfiler != nullptr)
+    {
+        gpuProfiler->beginScope(vulkanData.commandBuffers[vulkanData.currentImageIndex], name);
+    }
+}
+
+void ShadeApplication::endGpuScope()
+{
+    if (gpuProfiler != nullptr)
+    {
+        gpuProfiler->endScope(vulkanData.commandBuffers[vulkanData.currentImageIndex]);
+    }
+}
+
 float ShadeApplication::getFixedDeltaTime() { return fixedDeltaTime; }
 
+FrameStatistics *ShadeApplication::getFrameStatistics() { return &frameStatistics; }
+
+RenderCounters ShadeApplication::getFrameCounters() { return frameCounters; }
+
+RenderCounters ShadeApplication::getTotalCounters() { return totalCounters; }
+
 float ShadeApplication::getTimeSinceStartup() { return glfwGetTime(); }
 
 void ShadeApplication::updateFrameData()
 {
-    float currentTime = getTimeSinceStartup();
-    fixedDeltaTime = currentTime - prevTime;
+    double currentTime = glfwGetTime();
+
+    // The first frame's delta includes initialisation, keep it out of the statistics
+    if (prevTime > 0)
+    {
+        frameStatistics.addFrame(currentTime - prevTime);
+    }
+
+    fixedDeltaTime = (float)(currentTime - prevTime);
     prevTime = currentTime;
+
+    // Everything counted since the previous update belongs to the frame that just ended
+    frameCounters = renderCounters.collect();
+    totalCounters += frameCounters;
 }
\ No newline at end of file
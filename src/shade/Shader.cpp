@@ -1,13 +1,19 @@
 #include "shade/Shader.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
+#include "shade/Profiler.hpp"
+#include "shade/RenderCounters.hpp"
+
 using namespace Shade;
 
 Shader *Shader::loadFromSPIRV(VulkanApplication *app, ShaderLayout shaderLayout,
                               const char *vertPath, const char *fragPath, int shaderFlags)
 {
+    SHADE_PROFILE_ZONE("Shader::loadFromSPIRV");
+
     return new Shader(app, shaderLayout, readFileBytes(vertPath), readFileBytes(fragPath),
                       shaderFlags);
 }
@@ -15,6 +21,8 @@ Shader *Shader::loadFromSPIRV(VulkanApplication *app, ShaderLayout shaderLayout,
 Shader::Shader(VulkanApplication *app, ShaderLayout shaderLayout, std::vector<char> vertSource,
                std::vector<char> fragSource, int shaderFlags)
 {
+    SHADE_PROFILE_ZONE("Shader::Shader");
+
     this->app = app;
     this->vulkanData = app->_getVulkanData();
 
@@ -22,11 +30,16 @@ Shader::Shader(VulkanApplication *app, ShaderLayout shaderLayout, std::vector<ch
 
     this->shaderFlags = shaderFlags;
 
+    this->fallbackShader = nullptr;
+
+    createUniformLookupTables();
+
     // Load shader modules
     vertexModule = createShaderModule(vertSource);
     fragmentModule = createShaderModule(fragSource);
 
-    createGraphicsPipeline();
+    createPipelineLayout();
+    compileGraphicsPipeline();
 
     // Register shader
     app->_registerShader(this);
@@ -34,12 +47,14 @@ Shader::Shader(VulkanApplication *app, ShaderLayout shaderLayout, std::vector<ch
 
 Shader::~Shader()
 {
+    // Waits for a pending compilation, which may still use the shader modules
+    destroyGraphicsPipeline();
+    destroyPipelineLayout();
+
     // Cleanup shader modules
     vkDestroyShaderModule(vulkanData->device, vertexModule, nullptr);
     vkDestroyShaderModule(vulkanData->device, fragmentModule, nullptr);
 
-    destroyGraphicsPipeline();
-
     // Unregister shader
     app->_unregisterShader(this);
 }
@@ -90,65 +105,184 @@ VkPipelineLayout Shader::_getGraphicsPipelineLayout() { return this->graphicsPip
 
 VkDescriptorSet Shader::_getNewDescriptorSet()
 {
-    VkDescriptorSet descriptorSet;
+    // Shaders without uniforms don't bind a descriptor set
+    if (descriptorSetLayout == VK_NULL_HANDLE)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    AtomicRenderCounters::add(vulkanData->renderCounters->descriptorSetsAllocated);
+    return vulkanData->descriptorAllocator->allocate(descriptorSetLayout);
+}
 
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.pNext = nullptr;
-    allocInfo.descriptorPool = vulkanData->descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &descriptorSetLayout;
+void Shader::_releaseDescriptorSet(VkDescriptorSet descriptorSet)
+{
+    vulkanData->descriptorAllocator->release(descriptorSetLayout, descriptorSet);
+}
 
-    if (vkAllocateDescriptorSets(vulkanData->device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+VkDescriptorSet Shader::_getTransientDescriptorSet()
+{
+    if (descriptorSetLayout == VK_NULL_HANDLE)
     {
-        throw std::runtime_error("Shade: Failed to create new shader descriptor set.");
+        return VK_NULL_HANDLE;
     }
 
-    return descriptorSet;
+    AtomicRenderCounters::add(vulkanData->renderCounters->descriptorSetsAllocated);
+    return vulkanData->descriptorAllocator->allocateTransient(descriptorSetLayout);
 }
 
 ShaderLayout Shader::getShaderLayout() { return this->shaderLayout; }
 
-void Shader::createGraphicsPipeline()
+int Shader::_getUniformIndex(const std::string &uniformName)
 {
-    // Create graphics pipeline
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertexModule;
-    vertShaderStageInfo.pName = "main";
+    auto index = uniformIndices.find(uniformName);
+    if (index == uniformIndices.end())
+    {
+        return -1;
+    }
 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragmentModule;
-    fragShaderStageInfo.pName = "main";
+    return index->second;
+}
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+VkDescriptorType Shader::_getUniformDescriptorType(int uniformIndex)
+{
+    return uniformDescriptorTypes.at(uniformIndex);
+}
 
-    // Create vertex input binding description
+uint32_t Shader::_getUniformBinding(int uniformIndex)
+{
+    return shaderLayout.uniformsLayout.at(uniformIndex).binding;
+}
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+uint32_t Shader::_getUniformCount()
+{
+    return static_cast<uint32_t>(shaderLayout.uniformsLayout.size());
+}
 
-    VkVertexInputBindingDescription bindingDescription = {};
-    bindingDescription.binding = 0;
-    bindingDescription.stride = shaderLayout.vertexLayout.getStride(app, VERTEX);
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+const std::vector<uint32_t> &Shader::_getDynamicUniformStrides() { return dynamicUniformStrides; }
 
-    auto attributeDescriptions = shaderLayout.vertexLayout._getAttributeDescriptions();
+VkDescriptorUpdateTemplate Shader::_getDescriptorUpdateTemplate()
+{
+    return descriptorUpdateTemplate;
+}
 
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount =
-        static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+void Shader::createUniformLookupTables()
+{
+    uniformIndices.clear();
+    uniformDescriptorTypes.clear();
+
+    int i = 0;
+    for (const UniformLayoutEntry &entry : shaderLayout.uniformsLayout)
+    {
+        uniformIndices[entry.name] = i++;
+
+        if (std::holds_alternative<UniformTextureLayout>(entry.layout))
+        {
+            uniformDescriptorTypes.push_back(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+        }
+        else
+        {
+            uniformDescriptorTypes.push_back(entry.dynamic
+                                                 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+                                                 : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+        }
+    }
+
+    dynamicUniformStrides = shaderLayout.getDynamicUniformStrides(app);
+}
+
+void Shader::createDescriptorUpdateTemplate()
+{
+    descriptorUpdateTemplate = VK_NULL_HANDLE;
 
+    // Update templates are core in Vulkan 1.1
+    if (vulkanData->apiVersion < VK_API_VERSION_1_1 || descriptorSetLayout == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::vector<VkDescriptorUpdateTemplateEntry> entries;
+    for (uint32_t i = 0; i < shaderLayout.uniformsLayout.size(); i++)
+    {
+        VkDescriptorUpdateTemplateEntry entry = {};
+        entry.dstBinding = shaderLayout.uniformsLayout[i].binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = 1;
+        entry.descriptorType = uniformDescriptorTypes[i];
+        entry.offset = i * sizeof(UniformDescriptorInfo);
+        entry.stride = sizeof(UniformDescriptorInfo);
+
+        entries.push_back(entry);
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    createInfo.pNext = nullptr;
+    createInfo.flags = 0;
+    createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    createInfo.pDescriptorUpdateEntries = entries.data();
+    createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    createInfo.descriptorSetLayout = descriptorSetLayout;
+
+    if (vkCreateDescriptorUpdateTemplate(vulkanData->device, &createInfo, nullptr,
+                                         &descriptorUpdateTemplate) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create descriptor update template!");
+    }
+}
+
+void Shader::_pushConstants(VkCommandBuffer commandBuffer, void *data)
+{
+    char *rangeData = (char *)data;
+
+    for (size_t i = 0; i < pushConstantRanges.size(); i++)
+    {
+        StructuredBufferLayout &layout = shaderLayout.pushConstantsLayout[i].layout;
+        VkPushConstantRange &range = pushConstantRanges[i];
+
+        uint32_t unalignedSize = layout.getUnalignedStride();
+
+        if (unalignedSize == range.size)
+        {
+            // Layout contains no padding, data can be pushed as-is
+            vkCmdPushConstants(commandBuffer, graphicsPipelineLayout, range.stageFlags,
+                               range.offset, range.size, rangeData);
+        }
+        else
+        {
+            layout.alignDataInto(app, rangeData, 1, BufferUsage::UNIFORM,
+                                 pushConstantScratch.data());
+            vkCmdPushConstants(commandBuffer, graphicsPipelineLayout, range.stageFlags,
+                               range.offset, range.size, pushConstantScratch.data());
+        }
+
+        rangeData += unalignedSize;
+    }
+}
+
+VkShaderStageFlags Shader::_getVkShaderStageFlags(uint32_t stage)
+{
+    VkShaderStageFlags stageFlags = 0;
+
+    if (stage & ShaderStage::VERTEX_BIT)
+    {
+        stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    }
+
+    if (stage & ShaderStage::FRAGMENT_BIT)
+    {
+        stageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    return stageFlags;
+}
+
+void Shader::createPipelineLayout()
+{
     // Create uniform input binding description
+    descriptorSetLayout = VK_NULL_HANDLE;
     if (shaderLayout.uniformsLayout.size() > 0)
     {
-        descriptorSetLayout = {};
-
         std::vector<VkDescriptorSetLayoutBinding> bindings;
         bindings.resize(shaderLayout.uniformsLayout.size());
 
@@ -158,29 +292,9 @@ void Shader::createGraphicsPipeline()
 
             VkDescriptorSetLayoutBinding uniformLayoutBinding = {};
             uniformLayoutBinding.binding = entry.binding;
-
-            if (std::holds_alternative<StructuredBufferLayout>(entry.layout))
-            {
-                uniformLayoutBinding.descriptorType =
-                    entry.dynamic ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
-                                  : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            }
-            else if (std::holds_alternative<UniformTextureLayout>(entry.layout))
-            {
-                uniformLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            }
-
+            uniformLayoutBinding.descriptorType = uniformDescriptorTypes[i];
             uniformLayoutBinding.descriptorCount = 1;
-            uniformLayoutBinding.stageFlags = 0;
-            if (entry.stage & ShaderStage::VERTEX_BIT)
-            {
-                uniformLayoutBinding.stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
-            }
-
-            if (entry.stage & ShaderStage::FRAGMENT_BIT)
-            {
-                uniformLayoutBinding.stageFlags |= VK_SHADER_STAGE_FRAGMENT_BIT;
-            }
+            uniformLayoutBinding.stageFlags = _getVkShaderStageFlags(entry.stage);
             uniformLayoutBinding.pImmutableSamplers = nullptr;
 
             bindings[i] = uniformLayoutBinding;
@@ -197,29 +311,149 @@ void Shader::createGraphicsPipeline()
         }
     }
 
+    createDescriptorUpdateTemplate();
+
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    if (descriptorSetLayout != VK_NULL_HANDLE)
+    {
+        setLayouts.push_back(descriptorSetLayout);
+    }
+
+    emptyDescriptorSetLayout = VK_NULL_HANDLE;
+    if (_usesBindlessTextures())
+    {
+        if (vulkanData->bindlessTextures == nullptr)
+        {
+            throw std::runtime_error("Shade: Shader uses bindless textures but bindless mode is "
+                                     "not enabled in ShadeApplicationInfo!");
+        }
+
+        if (descriptorSetLayout == VK_NULL_HANDLE)
+        {
+            // Set indices can't be skipped, fill set 0 with an empty layout
+            VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+            layoutInfo.bindingCount = 0;
+            layoutInfo.pBindings = nullptr;
+            if (vkCreateDescriptorSetLayout(vulkanData->device, &layoutInfo, nullptr,
+                                            &emptyDescriptorSetLayout) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Shade: Failed to create descriptor set layout!");
+            }
+
+            setLayouts.push_back(emptyDescriptorSetLayout);
+        }
+
+        setLayouts.push_back(vulkanData->bindlessTextures->_getDescriptorSetLayout());
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.empty() ? nullptr : setLayouts.data();
+
+    // Collect push constant ranges
+    pushConstantRanges = shaderLayout._getPushConstantRanges(app);
+    std::vector<VkPushConstantRange> pipelineRanges =
+        shaderLayout._getPipelinePushConstantRanges(app);
+
+    size_t scratchSize = 0;
+    for (const VkPushConstantRange &range : pushConstantRanges)
+    {
+        scratchSize = std::max<size_t>(scratchSize, range.size);
+    }
+    pushConstantScratch.resize(scratchSize);
+
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pipelineRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges =
+        pipelineRanges.empty() ? nullptr : pipelineRanges.data();
+
+    if (vkCreatePipelineLayout(vulkanData->device, &pipelineLayoutInfo, nullptr,
+                               &graphicsPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create pipeline layout!");
+    }
+}
+
+void Shader::destroyPipelineLayout()
+{
+    if (descriptorUpdateTemplate != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorUpdateTemplate(vulkanData->device, descriptorUpdateTemplate, nullptr);
+    }
+
+    if (descriptorSetLayout != VK_NULL_HANDLE)
+    {
+        // Free recycled sets that were allocated with this layout
+        vulkanData->descriptorAllocator->releaseLayout(descriptorSetLayout);
+        vkDestroyDescriptorSetLayout(vulkanData->device, descriptorSetLayout, nullptr);
+    }
+    if (emptyDescriptorSetLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorSetLayout(vulkanData->device, emptyDescriptorSetLayout, nullptr);
+    }
+    vkDestroyPipelineLayout(vulkanData->device, graphicsPipelineLayout, nullptr);
+}
+
+void Shader::createGraphicsPipeline()
+{
+    // Runs on a worker thread for ASYNC_COMPILE shaders
+    SHADE_PROFILE_ZONE("Shader::createGraphicsPipeline");
+
+    // Create graphics pipeline
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertexModule;
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = fragmentModule;
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+    // Create vertex input binding description
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkVertexInputBindingDescription bindingDescription = {};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = shaderLayout.vertexLayout.getStride(app, VERTEX);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    auto attributeDescriptions = shaderLayout.vertexLayout._getAttributeDescriptions();
+
+    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexAttributeDescriptionCount =
+        static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)vulkanData->swapChainExtent.width;
-    viewport.height = (float)vulkanData->swapChainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = {0, 0};
-    scissor.extent = vulkanData->swapChainExtent;
-
+    // Viewport and scissor are set per frame, so the pipeline doesn't depend on
+    //  the swapchain extent
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -274,28 +508,6 @@ void Shader::createGraphicsPipeline()
     colorBlending.blendConstants[2] = 0.0f;
     colorBlending.blendConstants[3] = 0.0f;
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-    if (shaderLayout.uniformsLayout.size() > 0)
-    {
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    }
-    else
-    {
-        pipelineLayoutInfo.setLayoutCount = 0;
-        pipelineLayoutInfo.pSetLayouts = nullptr;
-    }
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if (vkCreatePipelineLayout(vulkanData->device, &pipelineLayoutInfo, nullptr,
-                               &graphicsPipelineLayout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Shade: Failed to create pipeline layout!");
-    }
-
     // Enable depth stencil
     VkPipelineDepthStencilStateCreateInfo depthStencil = {};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -339,39 +551,93 @@ void Shader::createGraphicsPipeline()
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = graphicsPipelineLayout;
     pipelineInfo.renderPass = vulkanData->renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(vulkanData->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
-                                  &graphicsPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(vulkanData->device,
+                                  vulkanData->pipelineCache->_getVkPipelineCache(), 1,
+                                  &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("Shade: Failed to create graphics pipeline!");
     }
+
+    AtomicRenderCounters::add(vulkanData->renderCounters->pipelinesCreated);
+}
+
+void Shader::compileGraphicsPipeline()
+{
+    graphicsPipeline = VK_NULL_HANDLE;
+    pipelineReady = false;
+
+    if ((shaderFlags & ShaderFlags::ASYNC_COMPILE) == ShaderFlags::ASYNC_COMPILE)
+    {
+        // Everything read by createGraphicsPipeline is immutable by now, and the
+        //  pipeline cache is internally synchronised
+        pipelineCompilation = vulkanData->threadPool->enqueue([this] {
+            createGraphicsPipeline();
+            pipelineReady = true;
+        });
+    }
+    else
+    {
+        createGraphicsPipeline();
+        pipelineReady = true;
+    }
 }
 
 void Shader::_recreateGraphicsPipeline()
 {
     destroyGraphicsPipeline();
-    createGraphicsPipeline();
+    compileGraphicsPipeline();
+}
+
+bool Shader::isReady() { return pipelineReady; }
+
+void Shader::waitUntilReady()
+{
+    if (pipelineCompilation.valid())
+    {
+        // Rethrows any exception thrown during compilation
+        pipelineCompilation.get();
+    }
+}
+
+void Shader::_waitForPipeline()
+{
+    if (pipelineCompilation.valid())
+    {
+        pipelineCompilation.wait();
+    }
+}
+
+void Shader::setFallbackShader(Shader *fallbackShader) { this->fallbackShader = fallbackShader; }
+
+Shader *Shader::getFallbackShader() { return this->fallbackShader; }
+
+bool Shader::_usesBindlessTextures()
+{
+    return (shaderFlags & ShaderFlags::BINDLESS_TEXTURES) == ShaderFlags::BINDLESS_TEXTURES;
 }
 
 void Shader::destroyGraphicsPipeline()
 {
-    vkDestroyDescriptorSetLayout(vulkanData->device, descriptorSetLayout, nullptr);
-    vkDestroyPipelineLayout(vulkanData->device, graphicsPipelineLayout, nullptr);
+    _waitForPipeline();
+
     vkDestroyPipeline(vulkanData->device, graphicsPipeline, nullptr);
 }
 
 // Shader Layout implementation:
 ShaderLayout::ShaderLayout(std::vector<UniformLayoutEntry> uniformsLayout,
-                           StructuredBufferLayout vertexLayout)
+                           StructuredBufferLayout vertexLayout,
+                           std::vector<PushConstantLayoutEntry> pushConstantsLayout)
 {
     this->uniformsLayout = uniformsLayout;
     this->vertexLayout = vertexLayout;
+    this->pushConstantsLayout = pushConstantsLayout;
 }
 
 ShaderLayout::~ShaderLayout() {}
@@ -391,4 +657,60 @@ std::vector<uint32_t> ShaderLayout::getDynamicUniformStrides(VulkanApplication *
     }
 
     return strides;
+}
+
+std::vector<VkPushConstantRange> ShaderLayout::_getPushConstantRanges(VulkanApplication *app)
+{
+    std::vector<VkPushConstantRange> ranges;
+
+    // Pushes must name every stage of the range containing them
+    uint32_t stages = 0;
+    for (PushConstantLayoutEntry &entry : pushConstantsLayout)
+    {
+        stages |= entry.stage;
+    }
+
+    uint32_t offset = 0;
+    for (PushConstantLayoutEntry &entry : pushConstantsLayout)
+    {
+        // Start each range on a 16 byte boundary to match the shader's block layout
+        offset = (offset + 15) & ~15u;
+
+        VkPushConstantRange range = {};
+        range.stageFlags = Shader::_getVkShaderStageFlags(stages);
+        range.offset = offset;
+        range.size = entry.layout.getStride(app, BufferUsage::UNIFORM);
+
+        ranges.push_back(range);
+
+        offset += range.size;
+    }
+
+    uint32_t maxPushConstantsSize =
+        app->_getVulkanData()->physicalDeviceProperties.limits.maxPushConstantsSize;
+
+    if (offset > maxPushConstantsSize)
+    {
+        throw std::runtime_error("Shade: Shader push constants exceed the device's "
+                                 "maxPushConstantsSize limit!");
+    }
+
+    return ranges;
+}
+
+std::vector<VkPushConstantRange>
+ShaderLayout::_getPipelinePushConstantRanges(VulkanApplication *app)
+{
+    std::vector<VkPushConstantRange> entryRanges = _getPushConstantRanges(app);
+    if (entryRanges.empty())
+    {
+        return {};
+    }
+
+    VkPushConstantRange range = {};
+    range.stageFlags = entryRanges[0].stageFlags;
+    range.offset = 0;
+    range.size = entryRanges.back().offset + entryRanges.back().size;
+
+    return {range};
 }
\ No newline at end of file
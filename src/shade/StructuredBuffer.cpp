@@ -238,11 +238,23 @@ std::vector<VkVertexInputAttributeDescription> StructuredBufferLayout::_getAttri
 void *StructuredBufferLayout::alignData(VulkanApplication *app, void *data, uint32_t count,
                                         BufferUsage bufferUsage)
 {
-    uint32_t alignment = getLargestBufferVariableAlignment();
-
     // Allocate new data
     void *newData = malloc(getAlignedStride(app, bufferUsage) * count);
 
+    alignDataInto(app, data, count, bufferUsage, newData);
+
+    return newData;
+}
+
+/**
+ * Write an aligned copy of the given data to 'alignedData', which must hold
+ * getAlignedStride() * count bytes.
+ */
+void StructuredBufferLayout::alignDataInto(VulkanApplication *app, void *data, uint32_t count,
+                                           BufferUsage bufferUsage, void *alignedData)
+{
+    char *newData = static_cast<char *>(alignedData);
+
     uint32_t uStructSize = getUnalignedStructStride();
     uint32_t aStructSize = getAlignedStride(app, bufferUsage);
     uint32_t structSizeDiff = aStructSize - uStructSize;
@@ -283,8 +295,6 @@ void *StructuredBufferLayout::alignData(VulkanApplication *app, void *data, uint
         memset((char *)newData + newDataPos, 0x00, structSizeDiff);
         newDataPos += structSizeDiff;
     }
-
-    return newData;
 }
 
 /**
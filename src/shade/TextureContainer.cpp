@@ -0,0 +1,353 @@
+#include "shade/TextureContainer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "shade/MipGenerator.hpp"
+#include "shade/TextureFormat.hpp"
+
+using namespace Shade;
+
+static const uint8_t ktx2Identifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+                                           0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+struct KTX2Header
+{
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+
+    // Followed by the unused 64-bit supercompression global data offset and
+    //  length, not part of the struct as they aren't 8-byte aligned in the file
+};
+
+// Level index following the header
+static const size_t ktx2LevelIndexOffset = sizeof(ktx2Identifier) + sizeof(KTX2Header) + 16;
+
+struct KTX2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static const uint32_t ddsMagic = 0x20534444; // "DDS "
+
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DDSHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static const uint32_t ddsPixelFormatFourCC = 0x4;
+static const uint32_t ddsPixelFormatRGB = 0x40;
+static const uint32_t ddsCaps2CubeMap = 0x200;
+static const uint32_t ddsCaps2Volume = 0x200000;
+
+static uint32_t fourCC(const char *code)
+{
+    return static_cast<uint32_t>(code[0]) | static_cast<uint32_t>(code[1]) << 8 |
+           static_cast<uint32_t>(code[2]) << 16 | static_cast<uint32_t>(code[3]) << 24;
+}
+
+static VkFormat getDXGIFormat(uint32_t dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+    case 28: // DXGI_FORMAT_R8G8B8A8_UNORM
+        return VK_FORMAT_R8G8B8A8_UNORM;
+    case 29: // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+        return VK_FORMAT_R8G8B8A8_SRGB;
+    case 71: // DXGI_FORMAT_BC1_UNORM
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: // DXGI_FORMAT_BC1_UNORM_SRGB
+        return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 74: // DXGI_FORMAT_BC2_UNORM
+        return VK_FORMAT_BC2_UNORM_BLOCK;
+    case 75: // DXGI_FORMAT_BC2_UNORM_SRGB
+        return VK_FORMAT_BC2_SRGB_BLOCK;
+    case 77: // DXGI_FORMAT_BC3_UNORM
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: // DXGI_FORMAT_BC3_UNORM_SRGB
+        return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: // DXGI_FORMAT_BC4_UNORM
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 81: // DXGI_FORMAT_BC4_SNORM
+        return VK_FORMAT_BC4_SNORM_BLOCK;
+    case 83: // DXGI_FORMAT_BC5_UNORM
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 84: // DXGI_FORMAT_BC5_SNORM
+        return VK_FORMAT_BC5_SNORM_BLOCK;
+    case 87: // DXGI_FORMAT_B8G8R8A8_UNORM
+        return VK_FORMAT_B8G8R8A8_UNORM;
+    case 91: // DXGI_FORMAT_B8G8R8A8_UNORM_SRGB
+        return VK_FORMAT_B8G8R8A8_SRGB;
+    case 95: // DXGI_FORMAT_BC6H_UF16
+        return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case 96: // DXGI_FORMAT_BC6H_SF16
+        return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+    case 98: // DXGI_FORMAT_BC7_UNORM
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: // DXGI_FORMAT_BC7_UNORM_SRGB
+        return VK_FORMAT_BC7_SRGB_BLOCK;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static VkFormat getLegacyDDSFormat(const DDSPixelFormat &pixelFormat)
+{
+    if (pixelFormat.flags & ddsPixelFormatFourCC)
+    {
+        if (pixelFormat.fourCC == fourCC("DXT1"))
+        {
+            return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        }
+        if (pixelFormat.fourCC == fourCC("DXT2") || pixelFormat.fourCC == fourCC("DXT3"))
+        {
+            return VK_FORMAT_BC2_UNORM_BLOCK;
+        }
+        if (pixelFormat.fourCC == fourCC("DXT4") || pixelFormat.fourCC == fourCC("DXT5"))
+        {
+            return VK_FORMAT_BC3_UNORM_BLOCK;
+        }
+        if (pixelFormat.fourCC == fourCC("ATI1") || pixelFormat.fourCC == fourCC("BC4U"))
+        {
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        }
+        if (pixelFormat.fourCC == fourCC("ATI2") || pixelFormat.fourCC == fourCC("BC5U"))
+        {
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        }
+    }
+    else if ((pixelFormat.flags & ddsPixelFormatRGB) && pixelFormat.rgbBitCount == 32)
+    {
+        if (pixelFormat.rBitMask == 0x000000FF && pixelFormat.bBitMask == 0x00FF0000)
+        {
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        }
+        if (pixelFormat.rBitMask == 0x00FF0000 && pixelFormat.bBitMask == 0x000000FF)
+        {
+            return VK_FORMAT_B8G8R8A8_UNORM;
+        }
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+TextureContainer::TextureContainer(std::string path) : file(path)
+{
+    if (file.getSize() >= sizeof(ktx2Identifier) &&
+        std::memcmp(file.getData(), ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+    {
+        readKTX2(path);
+    }
+    else if (file.getSize() >= sizeof(uint32_t) &&
+             std::memcmp(file.getData(), &ddsMagic, sizeof(uint32_t)) == 0)
+    {
+        readDDS(path);
+    }
+    else
+    {
+        throw std::runtime_error("Shade: '" + path + "' is not a KTX2 or DDS texture!");
+    }
+}
+
+void TextureContainer::readKTX2(std::string path)
+{
+    const uint8_t *data = file.getData();
+    size_t size = file.getSize();
+
+    KTX2Header header;
+    if (size < ktx2LevelIndexOffset)
+    {
+        throw std::runtime_error("Shade: KTX2 texture '" + path + "' is corrupt!");
+    }
+    std::memcpy(&header, data + sizeof(ktx2Identifier), sizeof(header));
+
+    if (header.supercompressionScheme != 0)
+    {
+        throw std::runtime_error("Shade: Supercompressed KTX2 texture '" + path +
+                                 "' isn't supported!");
+    }
+
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+    {
+        throw std::runtime_error("Shade: KTX2 texture '" + path + "' isn't a single 2D image!");
+    }
+
+    mipData = {};
+    mipData.format = static_cast<VkFormat>(header.vkFormat);
+    mipData.width = header.pixelWidth;
+    mipData.height = std::max(header.pixelHeight, 1u);
+
+    if (TextureFormat::getInfo(mipData.format).blockSize == 0)
+    {
+        throw std::runtime_error("Shade: KTX2 texture '" + path + "' has an unsupported format!");
+    }
+
+    // A level count of 0 asks for mipmaps to be generated, only load the base
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+
+    // Counts beyond the full chain would shift level sizes out of range
+    if (mipData.width == 0 ||
+        levelCount > MipGenerator::getMipLevelCount(mipData.width, mipData.height) ||
+        ktx2LevelIndexOffset + levelCount * sizeof(KTX2Level) > size)
+    {
+        throw std::runtime_error("Shade: KTX2 texture '" + path + "' is corrupt!");
+    }
+
+    std::vector<KTX2Level> levels(levelCount);
+    std::memcpy(levels.data(), data + ktx2LevelIndexOffset, levelCount * sizeof(KTX2Level));
+
+    // Levels are usually stored smallest first, stage the range covering all
+    uint64_t start = UINT64_MAX;
+    uint64_t end = 0;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        uint64_t expectedSize = TextureFormat::getLevelSize(
+            mipData.format, std::max(mipData.width >> i, 1u), std::max(mipData.height >> i, 1u));
+
+        if (levels[i].byteOffset > size || levels[i].byteLength > size - levels[i].byteOffset ||
+            levels[i].byteLength < expectedSize)
+        {
+            throw std::runtime_error("Shade: KTX2 texture '" + path + "' is corrupt!");
+        }
+
+        start = std::min(start, levels[i].byteOffset);
+        end = std::max(end, levels[i].byteOffset + levels[i].byteLength);
+    }
+
+    mipData.data = data + start;
+    mipData.size = end - start;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        mipData.levelOffsets.push_back(levels[i].byteOffset - start);
+    }
+}
+
+void TextureContainer::readDDS(std::string path)
+{
+    const uint8_t *data = file.getData();
+    size_t size = file.getSize();
+
+    size_t offset = sizeof(uint32_t);
+
+    DDSHeader header;
+    if (size < offset + sizeof(header))
+    {
+        throw std::runtime_error("Shade: DDS texture '" + path + "' is corrupt!");
+    }
+    std::memcpy(&header, data + offset, sizeof(header));
+    offset += sizeof(header);
+
+    if (header.caps2 & (ddsCaps2CubeMap | ddsCaps2Volume))
+    {
+        throw std::runtime_error("Shade: DDS texture '" + path + "' isn't a single 2D image!");
+    }
+
+    mipData = {};
+    mipData.width = header.width;
+    mipData.height = header.height;
+
+    if ((header.pixelFormat.flags & ddsPixelFormatFourCC) &&
+        header.pixelFormat.fourCC == fourCC("DX10"))
+    {
+        DDSHeaderDX10 headerDX10;
+        if (size < offset + sizeof(headerDX10))
+        {
+            throw std::runtime_error("Shade: DDS texture '" + path + "' is corrupt!");
+        }
+        std::memcpy(&headerDX10, data + offset, sizeof(headerDX10));
+        offset += sizeof(headerDX10);
+
+        if (headerDX10.arraySize > 1)
+        {
+            throw std::runtime_error("Shade: DDS texture '" + path + "' isn't a single 2D image!");
+        }
+
+        mipData.format = getDXGIFormat(headerDX10.dxgiFormat);
+    }
+    else
+    {
+        mipData.format = getLegacyDDSFormat(header.pixelFormat);
+    }
+
+    if (mipData.format == VK_FORMAT_UNDEFINED)
+    {
+        throw std::runtime_error("Shade: DDS texture '" + path + "' has an unsupported format!");
+    }
+
+    // Levels follow the headers back to back, largest first
+    uint32_t levelCount = std::max(header.mipMapCount, 1u);
+
+    // Counts beyond the full chain would shift level sizes out of range
+    if (mipData.width == 0 || mipData.height == 0 ||
+        levelCount > MipGenerator::getMipLevelCount(mipData.width, mipData.height))
+    {
+        throw std::runtime_error("Shade: DDS texture '" + path + "' is corrupt!");
+    }
+    VkDeviceSize levelOffset = 0;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        mipData.levelOffsets.push_back(levelOffset);
+        levelOffset += TextureFormat::getLevelSize(mipData.format,
+                                                   std::max(mipData.width >> i, 1u),
+                                                   std::max(mipData.height >> i, 1u));
+    }
+
+    if (offset + levelOffset > size)
+    {
+        throw std::runtime_error("Shade: DDS texture '" + path + "' is corrupt!");
+    }
+
+    mipData.data = data + offset;
+    mipData.size = levelOffset;
+}
+
+const UniformTextureMipData &TextureContainer::getMipData() { return mipData; }
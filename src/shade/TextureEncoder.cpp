@@ -0,0 +1,853 @@
+#include "shade/TextureEncoder.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <stdexcept>
+
+#include "shade/TextureFormat.hpp"
+#include "shade/ThreadPool.hpp"
+
+using namespace Shade;
+
+// Pixels of a 4x4 block, one array per channel so that the per-pixel loops
+//  below are vectorised by the compiler
+struct BlockPixels
+{
+    float r[16];
+    float g[16];
+    float b[16];
+    float a[16];
+};
+
+static void loadBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t blockX,
+                      uint32_t blockY, BlockPixels &block)
+{
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        // Blocks overlapping the edge repeat the last row/column
+        uint32_t pixelY = std::min(blockY * 4 + y, height - 1);
+
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            uint32_t pixelX = std::min(blockX * 4 + x, width - 1);
+            const uint8_t *pixel = pixels + (static_cast<size_t>(pixelY) * width + pixelX) * 4;
+
+            uint32_t i = y * 4 + x;
+            block.r[i] = pixel[0];
+            block.g[i] = pixel[1];
+            block.b[i] = pixel[2];
+            block.a[i] = pixel[3];
+        }
+    }
+}
+
+static float clampChannel(float value) { return std::min(std::max(value, 0.0f), 255.0f); }
+
+/**
+ * Find the palette entry closest to every pixel.
+ *
+ * @param alphaWeight 1 to include alpha in the error, 0 to ignore it
+ * @param indices receives the index of the closest entry of every pixel
+ * @param errors receives the squared error of every pixel
+ */
+static void selectIndices(const BlockPixels &block, const float (*palette)[4],
+                          uint32_t paletteSize, float alphaWeight, uint8_t indices[16],
+                          float errors[16])
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        errors[i] = FLT_MAX;
+        indices[i] = 0;
+    }
+
+    for (uint32_t k = 0; k < paletteSize; k++)
+    {
+        float candidate[16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float dr = block.r[i] - palette[k][0];
+            float dg = block.g[i] - palette[k][1];
+            float db = block.b[i] - palette[k][2];
+            float da = block.a[i] - palette[k][3];
+            candidate[i] = dr * dr + dg * dg + db * db + alphaWeight * da * da;
+        }
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            if (candidate[i] < errors[i])
+            {
+                errors[i] = candidate[i];
+                indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+    }
+}
+
+/**
+ * Single channel version of selectIndices.
+ */
+static float selectIndices(const float values[16], const float *palette, uint32_t paletteSize,
+                           uint8_t indices[16])
+{
+    float errors[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        errors[i] = FLT_MAX;
+        indices[i] = 0;
+    }
+
+    for (uint32_t k = 0; k < paletteSize; k++)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float difference = values[i] - palette[k];
+            float candidate = difference * difference;
+
+            if (candidate < errors[i])
+            {
+                errors[i] = candidate;
+                indices[i] = static_cast<uint8_t>(k);
+            }
+        }
+    }
+
+    float error = 0.0f;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        error += errors[i];
+    }
+    return error;
+}
+
+/**
+ * Pick initial endpoints for the pixels with a non-zero mask: the extremes of
+ *  the principal axis, or of the bounding box (inset slightly) for the fast
+ *  quality level.
+ */
+static void findEndpoints(const BlockPixels &block, const float mask[16], uint32_t channels,
+                          TextureEncoderQuality quality, float endpoint0[4], float endpoint1[4])
+{
+    const float *data[4] = {block.r, block.g, block.b, block.a};
+
+    float count = 0.0f;
+    float mean[4] = {};
+    float minimum[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+    float maximum[4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        if (mask[i] == 0.0f)
+        {
+            continue;
+        }
+
+        count++;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            mean[c] += data[c][i];
+            minimum[c] = std::min(minimum[c], data[c][i]);
+            maximum[c] = std::max(maximum[c], data[c][i]);
+        }
+    }
+
+    if (count == 0.0f)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            endpoint0[c] = endpoint1[c] = 0.0f;
+        }
+        return;
+    }
+
+    if (quality == TEXTURE_ENCODER_QUALITY_FAST)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            float inset = (maximum[c] - minimum[c]) / 16.0f;
+            endpoint0[c] = maximum[c] - inset;
+            endpoint1[c] = minimum[c] + inset;
+        }
+        return;
+    }
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        mean[c] /= count;
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        for (uint32_t c0 = 0; c0 < channels; c0++)
+        {
+            for (uint32_t c1 = 0; c1 < channels; c1++)
+            {
+                covariance[c0][c1] +=
+                    mask[i] * (data[c0][i] - mean[c0]) * (data[c1][i] - mean[c1]);
+            }
+        }
+    }
+
+    // Power iteration, starting from the bounding box diagonal
+    float axis[4] = {};
+    for (uint32_t c = 0; c < channels; c++)
+    {
+        axis[c] = maximum[c] - minimum[c];
+    }
+
+    for (uint32_t iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        for (uint32_t c0 = 0; c0 < channels; c0++)
+        {
+            for (uint32_t c1 = 0; c1 < channels; c1++)
+            {
+                next[c0] += covariance[c0][c1] * axis[c1];
+            }
+        }
+
+        float length = 0.0f;
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            length += next[c] * next[c];
+        }
+        length = std::sqrt(length);
+
+        if (length < 1e-6f)
+        {
+            break;
+        }
+
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minimumT = FLT_MAX;
+    float maximumT = -FLT_MAX;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        if (mask[i] == 0.0f)
+        {
+            continue;
+        }
+
+        float t = 0.0f;
+        for (uint32_t c = 0; c < channels; c++)
+        {
+            t += (data[c][i] - mean[c]) * axis[c];
+        }
+        minimumT = std::min(minimumT, t);
+        maximumT = std::max(maximumT, t);
+    }
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        endpoint0[c] = c < channels ? clampChannel(mean[c] + maximumT * axis[c]) : maximum[c];
+        endpoint1[c] = c < channels ? clampChannel(mean[c] + minimumT * axis[c]) : minimum[c];
+    }
+}
+
+/**
+ * Solve for the endpoints that best reproduce the pixels with the weights
+ *  (position between endpoint0 and endpoint1) of their chosen indices.
+ *
+ * @returns false if the weights don't determine the endpoints
+ */
+static bool refineEndpoints(const BlockPixels &block, const float mask[16],
+                            const uint8_t indices[16], const float *weights, float endpoint0[4],
+                            float endpoint1[4])
+{
+    const float *data[4] = {block.r, block.g, block.b, block.a};
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float rhs0[4] = {}, rhs1[4] = {};
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float t = weights[indices[i]] * mask[i];
+        float s = (1.0f - weights[indices[i]]) * mask[i];
+
+        aa += s * s;
+        ab += s * t;
+        bb += t * t;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            rhs0[c] += s * data[c][i];
+            rhs1[c] += t * data[c][i];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f)
+    {
+        return false;
+    }
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        endpoint0[c] = clampChannel((bb * rhs0[c] - ab * rhs1[c]) / determinant);
+        endpoint1[c] = clampChannel((aa * rhs1[c] - ab * rhs0[c]) / determinant);
+    }
+    return true;
+}
+
+static uint32_t getRefinementCount(TextureEncoderQuality quality)
+{
+    switch (quality)
+    {
+    case TEXTURE_ENCODER_QUALITY_FAST:
+        return 0;
+    case TEXTURE_ENCODER_QUALITY_NORMAL:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+static uint16_t packRGB565(const float colour[4])
+{
+    uint32_t r = static_cast<uint32_t>(std::lround(colour[0] * 31.0f / 255.0f));
+    uint32_t g = static_cast<uint32_t>(std::lround(colour[1] * 63.0f / 255.0f));
+    uint32_t b = static_cast<uint32_t>(std::lround(colour[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+static void unpackRGB565(uint16_t packed, float colour[4])
+{
+    uint32_t r = packed >> 11 & 31;
+    uint32_t g = packed >> 5 & 63;
+    uint32_t b = packed & 31;
+    colour[0] = static_cast<float>(r << 3 | r >> 2);
+    colour[1] = static_cast<float>(g << 2 | g >> 4);
+    colour[2] = static_cast<float>(b << 3 | b >> 2);
+    colour[3] = 255.0f;
+}
+
+/**
+ * Encode the colour of a block as a BC1 colour block (also used by BC3).
+ *
+ * @param punchThrough use BC1's 3 colour mode for blocks containing pixels
+ *  with alpha below 128, making them transparent
+ */
+static void encodeColourBlock(const BlockPixels &block, TextureEncoderQuality quality,
+                              bool punchThrough, uint8_t *output)
+{
+    float mask[16];
+    bool transparent = false;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        mask[i] = punchThrough && block.a[i] < 128.0f ? 0.0f : 1.0f;
+        transparent = transparent || mask[i] == 0.0f;
+    }
+
+    float endpoint0[4], endpoint1[4];
+    findEndpoints(block, mask, 3, quality, endpoint0, endpoint1);
+
+    // Weights of indices 0 to 3 in 4 colour and 3 colour mode
+    static const float opaqueWeights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    static const float transparentWeights[4] = {0.0f, 1.0f, 0.5f, 0.0f};
+    const float *weights = transparent ? transparentWeights : opaqueWeights;
+
+    float bestError = FLT_MAX;
+    uint16_t bestColours[2] = {};
+    uint32_t bestIndices = 0;
+
+    uint32_t refinements = getRefinementCount(quality);
+    for (uint32_t iteration = 0; iteration <= refinements; iteration++)
+    {
+        uint16_t colour0 = packRGB565(endpoint0);
+        uint16_t colour1 = packRGB565(endpoint1);
+
+        // The order of the endpoints selects the mode: 4 colours if colour0 is
+        //  greater, otherwise 3 colours and transparent black
+        if (transparent ? colour0 > colour1 : colour0 < colour1)
+        {
+            std::swap(colour0, colour1);
+        }
+
+        float palette[4][4];
+        unpackRGB565(colour0, palette[0]);
+        unpackRGB565(colour1, palette[1]);
+
+        uint32_t paletteSize;
+        if (transparent)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+            }
+            paletteSize = 3;
+        }
+        else if (colour0 == colour1)
+        {
+            // Would be decoded in 3 colour mode, only use the endpoint itself
+            paletteSize = 1;
+        }
+        else
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+            paletteSize = 4;
+        }
+
+        uint8_t indices[16];
+        float errors[16];
+        selectIndices(block, palette, paletteSize, 0.0f, indices, errors);
+
+        float error = 0.0f;
+        uint32_t packedIndices = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            if (mask[i] == 0.0f)
+            {
+                indices[i] = 3;
+            }
+            error += mask[i] * errors[i];
+            packedIndices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            bestColours[0] = colour0;
+            bestColours[1] = colour1;
+            bestIndices = packedIndices;
+        }
+
+        if (iteration == refinements ||
+            !refineEndpoints(block, mask, indices, weights, endpoint0, endpoint1))
+        {
+            break;
+        }
+    }
+
+    output[0] = static_cast<uint8_t>(bestColours[0] & 0xFF);
+    output[1] = static_cast<uint8_t>(bestColours[0] >> 8);
+    output[2] = static_cast<uint8_t>(bestColours[1] & 0xFF);
+    output[3] = static_cast<uint8_t>(bestColours[1] >> 8);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        output[4 + i] = static_cast<uint8_t>(bestIndices >> (i * 8));
+    }
+}
+
+/**
+ * Build the palette of a BC4 block (also used for BC3 alpha and BC5): 8
+ *  interpolated values if value0 > value1, otherwise 6 and the extremes.
+ */
+static void getSingleChannelPalette(uint32_t value0, uint32_t value1, float palette[8])
+{
+    palette[0] = static_cast<float>(value0);
+    palette[1] = static_cast<float>(value1);
+
+    if (value0 > value1)
+    {
+        for (uint32_t i = 1; i < 7; i++)
+        {
+            palette[i + 1] = static_cast<float>(((7 - i) * value0 + i * value1 + 3) / 7);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; i++)
+        {
+            palette[i + 1] = static_cast<float>(((5 - i) * value0 + i * value1 + 2) / 5);
+        }
+        palette[6] = 0.0f;
+        palette[7] = 255.0f;
+    }
+}
+
+static void encodeSingleChannelBlock(const float values[16], TextureEncoderQuality quality,
+                                     uint8_t *output)
+{
+    float minimum = 255.0f, maximum = 0.0f;
+
+    // Range of the values other than the extremes, which 6 value mode stores exactly
+    float innerMinimum = 255.0f, innerMaximum = 0.0f;
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        minimum = std::min(minimum, values[i]);
+        maximum = std::max(maximum, values[i]);
+
+        if (values[i] > 0.0f && values[i] < 255.0f)
+        {
+            innerMinimum = std::min(innerMinimum, values[i]);
+            innerMaximum = std::max(innerMaximum, values[i]);
+        }
+    }
+
+    struct Candidate
+    {
+        uint32_t value0;
+        uint32_t value1;
+    };
+    std::vector<Candidate> candidates;
+
+    uint32_t high = static_cast<uint32_t>(maximum);
+    uint32_t low = static_cast<uint32_t>(minimum);
+    candidates.push_back({high, low});
+
+    if (quality != TEXTURE_ENCODER_QUALITY_FAST && innerMinimum <= innerMaximum)
+    {
+        candidates.push_back(
+            {static_cast<uint32_t>(innerMinimum), static_cast<uint32_t>(innerMaximum)});
+    }
+
+    // Shrink the range a little, trading exact extremes for finer steps
+    if (quality == TEXTURE_ENCODER_QUALITY_HIGH)
+    {
+        for (uint32_t inset0 = 0; inset0 <= 2; inset0++)
+        {
+            for (uint32_t inset1 = 0; inset1 <= 2; inset1++)
+            {
+                if ((inset0 > 0 || inset1 > 0) && high >= low + inset0 + inset1 + 1)
+                {
+                    candidates.push_back({high - inset0, low + inset1});
+                }
+            }
+        }
+    }
+
+    float bestError = FLT_MAX;
+    Candidate bestCandidate = candidates[0];
+    uint8_t bestIndices[16] = {};
+
+    for (const Candidate &candidate : candidates)
+    {
+        float palette[8];
+        getSingleChannelPalette(candidate.value0, candidate.value1, palette);
+
+        uint8_t indices[16];
+        float error = selectIndices(values, palette, 8, indices);
+
+        if (error < bestError)
+        {
+            bestError = error;
+            bestCandidate = candidate;
+            std::memcpy(bestIndices, indices, sizeof(indices));
+        }
+    }
+
+    output[0] = static_cast<uint8_t>(bestCandidate.value0);
+    output[1] = static_cast<uint8_t>(bestCandidate.value1);
+
+    uint64_t packedIndices = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        packedIndices |= static_cast<uint64_t>(bestIndices[i]) << (i * 3);
+    }
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        output[2 + i] = static_cast<uint8_t>(packedIndices >> (i * 8));
+    }
+}
+
+// Writes values into a zeroed block, least significant bit first
+struct BitWriter
+{
+    uint8_t *data;
+    uint32_t position;
+
+    void write(uint32_t value, uint32_t bits)
+    {
+        for (uint32_t i = 0; i < bits; i++, position++)
+        {
+            data[position / 8] |= static_cast<uint8_t>((value >> i & 1) << (position % 8));
+        }
+    }
+};
+
+// Quantise an endpoint to BC7 mode 6 precision: 7 bits per channel and a
+//  shared lowest bit (the p-bit)
+static void quantizeBC7Endpoint(const float endpoint[4], uint32_t pBit, uint32_t quantized[4],
+                                float reconstructed[4])
+{
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        int32_t value = static_cast<int32_t>(std::lround((endpoint[c] - pBit) / 2.0f));
+        quantized[c] = static_cast<uint32_t>(std::min(std::max(value, 0), 127));
+        reconstructed[c] = static_cast<float>(quantized[c] << 1 | pBit);
+    }
+}
+
+static uint32_t getBestPBit(const float endpoint[4])
+{
+    float bestError = FLT_MAX;
+    uint32_t bestPBit = 0;
+
+    for (uint32_t pBit = 0; pBit < 2; pBit++)
+    {
+        uint32_t quantized[4];
+        float reconstructed[4];
+        quantizeBC7Endpoint(endpoint, pBit, quantized, reconstructed);
+
+        float error = 0.0f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            error += (reconstructed[c] - endpoint[c]) * (reconstructed[c] - endpoint[c]);
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            bestPBit = pBit;
+        }
+    }
+
+    return bestPBit;
+}
+
+static void encodeBC7Block(const BlockPixels &block, TextureEncoderQuality quality,
+                           uint8_t *output)
+{
+    static const uint32_t weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                         34, 38, 43, 47, 51, 55, 60, 64};
+    static const float normalizedWeights[16] = {
+        0 / 64.0f,  4 / 64.0f,  9 / 64.0f,  13 / 64.0f, 17 / 64.0f, 21 / 64.0f,
+        26 / 64.0f, 30 / 64.0f, 34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f,
+        51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f};
+
+    float mask[16];
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        mask[i] = 1.0f;
+    }
+
+    float endpoint0[4], endpoint1[4];
+    findEndpoints(block, mask, 4, quality, endpoint0, endpoint1);
+
+    float bestError = FLT_MAX;
+    uint32_t bestQuantized[2][4] = {};
+    uint32_t bestPBits[2] = {};
+    uint8_t bestIndices[16] = {};
+
+    uint32_t refinements = getRefinementCount(quality);
+    for (uint32_t iteration = 0; iteration <= refinements; iteration++)
+    {
+        // Every p-bit combination is evaluated at the highest quality,
+        //  otherwise the p-bit closest to each endpoint is used
+        uint32_t pBitCombinations[4][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+        uint32_t combinationCount = 4;
+        if (quality != TEXTURE_ENCODER_QUALITY_HIGH)
+        {
+            pBitCombinations[0][0] = getBestPBit(endpoint0);
+            pBitCombinations[0][1] = getBestPBit(endpoint1);
+            combinationCount = 1;
+        }
+
+        uint8_t iterationIndices[16];
+        float iterationError = FLT_MAX;
+
+        for (uint32_t combination = 0; combination < combinationCount; combination++)
+        {
+            uint32_t quantized[2][4];
+            float reconstructed[2][4];
+            quantizeBC7Endpoint(endpoint0, pBitCombinations[combination][0], quantized[0],
+                                reconstructed[0]);
+            quantizeBC7Endpoint(endpoint1, pBitCombinations[combination][1], quantized[1],
+                                reconstructed[1]);
+
+            float palette[16][4];
+            for (uint32_t k = 0; k < 16; k++)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    uint32_t value0 = static_cast<uint32_t>(reconstructed[0][c]);
+                    uint32_t value1 = static_cast<uint32_t>(reconstructed[1][c]);
+                    palette[k][c] = static_cast<float>(
+                        ((64 - weights[k]) * value0 + weights[k] * value1 + 32) >> 6);
+                }
+            }
+
+            uint8_t indices[16];
+            float errors[16];
+            selectIndices(block, palette, 16, 1.0f, indices, errors);
+
+            float error = 0.0f;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                error += errors[i];
+            }
+
+            if (error < iterationError)
+            {
+                iterationError = error;
+                std::memcpy(iterationIndices, indices, sizeof(indices));
+            }
+
+            if (error < bestError)
+            {
+                bestError = error;
+                std::memcpy(bestQuantized, quantized, sizeof(quantized));
+                bestPBits[0] = pBitCombinations[combination][0];
+                bestPBits[1] = pBitCombinations[combination][1];
+                std::memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+
+        if (iteration == refinements || !refineEndpoints(block, mask, iterationIndices,
+                                                         normalizedWeights, endpoint0, endpoint1))
+        {
+            break;
+        }
+    }
+
+    // The first index is stored without its top bit, which must be 0: swap the
+    //  endpoints and invert the indices if it isn't
+    if (bestIndices[0] & 8)
+    {
+        std::swap(bestQuantized[0], bestQuantized[1]);
+        std::swap(bestPBits[0], bestPBits[1]);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            bestIndices[i] = static_cast<uint8_t>(15 - bestIndices[i]);
+        }
+    }
+
+    std::memset(output, 0, 16);
+    BitWriter writer = {output, 0};
+
+    writer.write(1 << 6, 7); // Mode 6
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        writer.write(bestQuantized[0][c], 7);
+        writer.write(bestQuantized[1][c], 7);
+    }
+
+    writer.write(bestPBits[0], 1);
+    writer.write(bestPBits[1], 1);
+
+    writer.write(bestIndices[0], 3);
+    for (uint32_t i = 1; i < 16; i++)
+    {
+        writer.write(bestIndices[i], 4);
+    }
+}
+
+static void encodeBlock(const BlockPixels &block, VkFormat format, TextureEncoderQuality quality,
+                        uint8_t *output)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        encodeColourBlock(block, quality, false, output);
+        break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        encodeColourBlock(block, quality, true, output);
+        break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        encodeSingleChannelBlock(block.a, quality, output);
+        encodeColourBlock(block, quality, false, output + 8);
+        break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        encodeSingleChannelBlock(block.r, quality, output);
+        break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        encodeSingleChannelBlock(block.r, quality, output);
+        encodeSingleChannelBlock(block.g, quality, output + 8);
+        break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        encodeBC7Block(block, quality, output);
+        break;
+    default:
+        break;
+    }
+}
+
+TextureEncoder::TextureEncoder(ThreadPool *threadPool, TextureEncoderQuality quality)
+{
+    this->threadPool = threadPool;
+    this->quality = quality;
+}
+
+std::vector<uint8_t> TextureEncoder::encode(const uint8_t *pixels, uint32_t width, uint32_t height,
+                                            VkFormat format)
+{
+    if (!isSupportedFormat(format))
+    {
+        throw std::runtime_error("Shade: Texture encoder doesn't support the requested format!");
+    }
+
+    uint32_t blockSize = TextureFormat::getInfo(format).blockSize;
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+
+    std::vector<uint8_t> output(static_cast<size_t>(blocksX) * blocksY * blockSize);
+    uint8_t *outputData = output.data();
+    TextureEncoderQuality quality = this->quality;
+
+    auto encodeRows = [=](uint32_t firstRow, uint32_t lastRow) {
+        BlockPixels block;
+        for (uint32_t blockY = firstRow; blockY < lastRow; blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+            {
+                loadBlock(pixels, width, height, blockX, blockY, block);
+                encodeBlock(block, format, quality,
+                            outputData + (static_cast<size_t>(blockY) * blocksX + blockX) *
+                                             blockSize);
+            }
+        }
+    };
+
+    if (threadPool == nullptr || blocksY < 2)
+    {
+        encodeRows(0, blocksY);
+        return output;
+    }
+
+    // A few tasks per thread, so that threads finishing early can help out
+    uint32_t taskCount = std::min(blocksY, threadPool->getThreadCount() * 4);
+    uint32_t rowsPerTask = (blocksY + taskCount - 1) / taskCount;
+
+    std::vector<std::future<void>> tasks;
+    for (uint32_t firstRow = 0; firstRow < blocksY; firstRow += rowsPerTask)
+    {
+        uint32_t lastRow = std::min(firstRow + rowsPerTask, blocksY);
+        tasks.push_back(threadPool->enqueue([=] { encodeRows(firstRow, lastRow); }));
+    }
+
+    for (std::future<void> &task : tasks)
+    {
+        task.get();
+    }
+
+    return output;
+}
+
+void TextureEncoder::setQuality(TextureEncoderQuality quality) { this->quality = quality; }
+
+TextureEncoderQuality TextureEncoder::getQuality() { return quality; }
+
+bool TextureEncoder::isSupportedFormat(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,399 @@
+#include "shade/TextureFormat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace Shade;
+
+// IEEE 754 half precision conversion, rounding to nearest even
+static uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (floatExponent == 0xff)
+    {
+        // Infinity stays infinity, NaN stays NaN
+        return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+    }
+
+    int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+    if (exponent >= 31)
+    {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+        {
+            return static_cast<uint16_t>(sign);
+        }
+
+        // Subnormal, shift the mantissa with its implicit leading bit into place
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // A carry out of the mantissa correctly moves into the exponent
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+static float halfToFloat(uint16_t half)
+{
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0)
+    {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -value : value;
+    }
+
+    uint32_t bits = sign | (mantissa << 13);
+    bits |= exponent == 31 ? 0x7f800000 : (exponent + 127 - 15) << 23;
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Unsigned floats of B10G11R11 share the exponent of half floats but have
+//  fewer mantissa bits and no sign
+static uint32_t floatToUnsignedFloat(float value, uint32_t mantissaBits)
+{
+    if (!(value > 0.0f))
+    {
+        return 0; // Negative and NaN
+    }
+
+    uint32_t shift = 10 - mantissaBits;
+    uint32_t half = floatToHalf(value);
+    return (half + (1u << (shift - 1))) >> shift;
+}
+
+static float unsignedFloatToFloat(uint32_t value, uint32_t mantissaBits)
+{
+    return halfToFloat(static_cast<uint16_t>(value << (10 - mantissaBits)));
+}
+
+static float readChannel(const TextureFormatInfo &info, const uint8_t *channel)
+{
+    if (info.channelBits == 8)
+    {
+        return *channel / 255.0f;
+    }
+
+    if (info.channelBits == 16)
+    {
+        uint16_t value;
+        std::memcpy(&value, channel, sizeof(value));
+        return info.floatingPoint ? halfToFloat(value) : value / 65535.0f;
+    }
+
+    float value;
+    std::memcpy(&value, channel, sizeof(value));
+    return value;
+}
+
+static void writeChannel(const TextureFormatInfo &info, float value, uint8_t *channel)
+{
+    if (info.channelBits == 8)
+    {
+        *channel = static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+    else if (info.channelBits == 16)
+    {
+        uint16_t encoded = static_cast<uint16_t>(std::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        if (info.floatingPoint)
+        {
+            // Keep values finite, infinities would spread through filtering
+            encoded = floatToHalf(std::clamp(value, -65504.0f, 65504.0f));
+        }
+        std::memcpy(channel, &encoded, sizeof(encoded));
+    }
+    else
+    {
+        std::memcpy(channel, &value, sizeof(value));
+    }
+}
+
+static bool isBGRA(VkFormat format)
+{
+    return format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+static TextureFormatInfo getUncompressedInfo(uint32_t channels, uint32_t channelBits,
+                                             bool floatingPoint = false)
+{
+    TextureFormatInfo info;
+    info.blockSize = channels * channelBits / 8;
+    info.channels = channels;
+    info.channelBits = channelBits;
+    info.floatingPoint = floatingPoint;
+    return info;
+}
+
+static TextureFormatInfo getBlockCompressedInfo(uint32_t blockSize, uint32_t channels,
+                                                bool floatingPoint = false)
+{
+    TextureFormatInfo info;
+    info.blockWidth = 4;
+    info.blockHeight = 4;
+    info.blockSize = blockSize;
+    info.channels = channels;
+    info.floatingPoint = floatingPoint;
+    return info;
+}
+
+TextureFormatInfo TextureFormat::getInfo(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return getUncompressedInfo(1, 8);
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+        return getUncompressedInfo(2, 8);
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return getUncompressedInfo(4, 8);
+
+    case VK_FORMAT_R16_UNORM:
+        return getUncompressedInfo(1, 16);
+    case VK_FORMAT_R16G16_UNORM:
+        return getUncompressedInfo(2, 16);
+    case VK_FORMAT_R16G16B16A16_UNORM:
+        return getUncompressedInfo(4, 16);
+    case VK_FORMAT_R16_SFLOAT:
+        return getUncompressedInfo(1, 16, true);
+    case VK_FORMAT_R16G16_SFLOAT:
+        return getUncompressedInfo(2, 16, true);
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return getUncompressedInfo(4, 16, true);
+
+    case VK_FORMAT_R32_SFLOAT:
+        return getUncompressedInfo(1, 32, true);
+    case VK_FORMAT_R32G32_SFLOAT:
+        return getUncompressedInfo(2, 32, true);
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return getUncompressedInfo(4, 32, true);
+
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    {
+        TextureFormatInfo info = getUncompressedInfo(3, 0, true);
+        info.blockSize = 4;
+        return info;
+    }
+
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        return getBlockCompressedInfo(8, 3);
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        return getBlockCompressedInfo(8, 4);
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return getBlockCompressedInfo(8, 1);
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+        return getBlockCompressedInfo(16, 2);
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        return getBlockCompressedInfo(16, 3, true);
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return getBlockCompressedInfo(16, 4);
+
+    default:
+        return TextureFormatInfo();
+    }
+}
+
+bool TextureFormat::isBlockCompressed(VkFormat format)
+{
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+bool TextureFormat::isSRGB(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_SRGB:
+    case VK_FORMAT_R8G8_SRGB:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+VkFormat TextureFormat::getUncompressedFormat(uint32_t channels, uint32_t channelBits)
+{
+    // Three channel formats are rarely supported for sampling, so there are none
+    static const VkFormat formats[3][4] = {
+        {VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_UNDEFINED, VK_FORMAT_R8G8B8A8_UNORM},
+        {VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_UNDEFINED,
+         VK_FORMAT_R16G16B16A16_UNORM},
+        {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_UNDEFINED,
+         VK_FORMAT_R32G32B32A32_SFLOAT}};
+
+    if (channels < 1 || channels > 4)
+    {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    switch (channelBits)
+    {
+    case 8:
+        return formats[0][channels - 1];
+    case 16:
+        return formats[1][channels - 1];
+    case 32:
+        return formats[2][channels - 1];
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+bool TextureFormat::isConvertible(VkFormat format)
+{
+    TextureFormatInfo info = getInfo(format);
+    return info.blockSize != 0 && info.blockWidth == 1 && info.blockHeight == 1;
+}
+
+void TextureFormat::decodePixels(VkFormat format, const void *pixels, size_t pixelCount,
+                                 float *rgba)
+{
+    if (!isConvertible(format))
+    {
+        throw std::runtime_error("Shade: Can't convert pixels of a compressed or unknown format!");
+    }
+
+    TextureFormatInfo info = getInfo(format);
+    const uint8_t *source = static_cast<const uint8_t *>(pixels);
+
+    if (format == VK_FORMAT_B10G11R11_UFLOAT_PACK32)
+    {
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            uint32_t packed;
+            std::memcpy(&packed, source + i * 4, sizeof(packed));
+            rgba[i * 4 + 0] = unsignedFloatToFloat(packed & 0x7ff, 6);
+            rgba[i * 4 + 1] = unsignedFloatToFloat((packed >> 11) & 0x7ff, 6);
+            rgba[i * 4 + 2] = unsignedFloatToFloat(packed >> 22, 5);
+            rgba[i * 4 + 3] = 1.0f;
+        }
+        return;
+    }
+
+    uint32_t channelSize = info.channelBits / 8;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        const uint8_t *pixel = source + i * info.blockSize;
+        float *destination = rgba + i * 4;
+
+        destination[0] = destination[1] = destination[2] = 0.0f;
+        destination[3] = 1.0f;
+        for (uint32_t c = 0; c < info.channels; c++)
+        {
+            destination[c] = readChannel(info, pixel + c * channelSize);
+        }
+
+        if (isBGRA(format))
+        {
+            std::swap(destination[0], destination[2]);
+        }
+    }
+}
+
+void TextureFormat::encodePixels(VkFormat format, const float *rgba, size_t pixelCount,
+                                 void *pixels)
+{
+    if (!isConvertible(format))
+    {
+        throw std::runtime_error("Shade: Can't convert pixels of a compressed or unknown format!");
+    }
+
+    TextureFormatInfo info = getInfo(format);
+    uint8_t *destination = static_cast<uint8_t *>(pixels);
+
+    if (format == VK_FORMAT_B10G11R11_UFLOAT_PACK32)
+    {
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            // Values too large for the format become infinity, clamp them to
+            //  the largest finite value instead
+            uint32_t r = std::min(floatToUnsignedFloat(rgba[i * 4 + 0], 6), 0x7bfu);
+            uint32_t g = std::min(floatToUnsignedFloat(rgba[i * 4 + 1], 6), 0x7bfu);
+            uint32_t b = std::min(floatToUnsignedFloat(rgba[i * 4 + 2], 5), 0x3dfu);
+
+            uint32_t packed = r | (g << 11) | (b << 22);
+            std::memcpy(destination + i * 4, &packed, sizeof(packed));
+        }
+        return;
+    }
+
+    uint32_t channelSize = info.channelBits / 8;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        const float *source = rgba + i * 4;
+        uint8_t *pixel = destination + i * info.blockSize;
+
+        float swizzled[4] = {source[0], source[1], source[2], source[3]};
+        if (isBGRA(format))
+        {
+            std::swap(swizzled[0], swizzled[2]);
+        }
+
+        for (uint32_t c = 0; c < info.channels; c++)
+        {
+            writeChannel(info, swizzled[c], pixel + c * channelSize);
+        }
+    }
+}
+
+VkDeviceSize TextureFormat::getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    TextureFormatInfo info = getInfo(format);
+
+    // Partial blocks at the edges are stored whole
+    VkDeviceSize blocksX = (width + info.blockWidth - 1) / info.blockWidth;
+    VkDeviceSize blocksY = (height + info.blockHeight - 1) / info.blockHeight;
+
+    return blocksX * blocksY * info.blockSize;
+}
@@ -0,0 +1,247 @@
+#include "shade/TextureLoader.hpp"
+
+#include <stdexcept>
+
+#include "shade/Profiler.hpp"
+#include "shade/TextureFormat.hpp"
+#include "shade/ThreadPool.hpp"
+#include "shade/UploadBatch.hpp"
+
+using namespace Shade;
+
+TextureLoader::TextureLoader(VulkanApplication *app, VkDeviceSize maxBytesPerFrame)
+{
+    this->app = app;
+    this->vulkanData = app->_getVulkanData();
+    this->maxBytesPerFrame = maxBytesPerFrame;
+
+    decoding = 0;
+}
+
+TextureLoader::~TextureLoader()
+{
+    // Decode tasks reference the loader, so they must finish first
+    {
+        std::unique_lock<std::mutex> lock(decodedMutex);
+        decodeFinished.wait(lock, [this] { return decoding == 0; });
+    }
+
+    // Nothing is uploaded at shutdown, outstanding loads fail instead
+    std::exception_ptr cancelled = std::make_exception_ptr(std::runtime_error(
+        "Shade: Texture loader was destroyed before the texture was uploaded!"));
+
+    for (std::shared_ptr<Request> &request : decoded)
+    {
+        if (request->error)
+        {
+            request->promise.set_exception(request->error);
+            continue;
+        }
+
+        UniformTexture::_freePixelData(request->pixelData);
+        request->promise.set_exception(cancelled);
+    }
+    decoded.clear();
+
+    // Textures of uploads already submitted have no owner yet
+    for (InFlightBatch &inFlightBatch : inFlight)
+    {
+        inFlightBatch.batch->wait();
+
+        for (size_t i = 0; i < inFlightBatch.textures.size(); i++)
+        {
+            delete inFlightBatch.textures[i];
+            inFlightBatch.requests[i]->promise.set_exception(cancelled);
+        }
+
+        delete inFlightBatch.batch;
+    }
+    inFlight.clear();
+}
+
+std::shared_future<UniformTexture *>
+TextureLoader::load(std::string path, UniformTextureFilterMode filterMode, bool enableMipmaps,
+                    VkFormat format)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->path = path;
+    request->filterMode = filterMode;
+    request->enableMipmaps = enableMipmaps;
+    request->format = format;
+
+    std::shared_future<UniformTexture *> future = request->promise.get_future().share();
+
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoding++;
+    }
+
+    vulkanData->threadPool->enqueue([this, request] { decode(request); });
+
+    return future;
+}
+
+std::vector<std::shared_future<UniformTexture *>>
+TextureLoader::loadBatch(const std::vector<std::string> &paths,
+                         UniformTextureFilterMode filterMode, bool enableMipmaps,
+                         VkFormat format)
+{
+    std::vector<std::shared_future<UniformTexture *>> futures;
+    futures.reserve(paths.size());
+
+    for (const std::string &path : paths)
+    {
+        futures.push_back(load(path, filterMode, enableMipmaps, format));
+    }
+
+    return futures;
+}
+
+void TextureLoader::decode(std::shared_ptr<Request> request)
+{
+    SHADE_PROFILE_ZONE("TextureLoader::decode");
+
+    try
+    {
+        request->pixelData = UniformTexture::_loadPixelData(request->path, request->format,
+                                                             vulkanData->physicalDevice);
+    }
+    catch (...)
+    {
+        request->error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoded.push_back(request);
+        decoding--;
+    }
+    decodeFinished.notify_all();
+}
+
+void TextureLoader::_processUploads()
+{
+    SHADE_PROFILE_ZONE("TextureLoader::_processUploads");
+
+    completeBatches(false);
+    recordUploads(false);
+}
+
+void TextureLoader::recordUploads(bool unlimited)
+{
+    std::vector<std::shared_ptr<Request>> requests;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        if (decoded.empty())
+        {
+            return;
+        }
+
+        // Take requests in decoding order until the per-frame limit is reached,
+        //  always at least one so that large textures still make progress
+        VkDeviceSize bytes = 0;
+        size_t count = 0;
+        while (count < decoded.size() && (unlimited || count == 0 || bytes < maxBytesPerFrame))
+        {
+            const UniformTexturePixelData &pixelData = decoded[count]->pixelData;
+            bytes += TextureFormat::getLevelSize(pixelData.format, pixelData.width,
+                                                 pixelData.height);
+            count++;
+        }
+
+        requests.assign(decoded.begin(), decoded.begin() + count);
+        decoded.erase(decoded.begin(), decoded.begin() + count);
+    }
+
+    InFlightBatch inFlightBatch;
+    inFlightBatch.batch = new UploadBatch(app);
+
+    for (std::shared_ptr<Request> &request : requests)
+    {
+        if (request->error)
+        {
+            request->promise.set_exception(request->error);
+            continue;
+        }
+
+        try
+        {
+            UniformTexture *texture =
+                new UniformTexture(app, request->pixelData, request->filterMode,
+                                   request->enableMipmaps, inFlightBatch.batch);
+
+            inFlightBatch.textures.push_back(texture);
+            inFlightBatch.requests.push_back(request);
+        }
+        catch (...)
+        {
+            request->promise.set_exception(std::current_exception());
+        }
+
+        // Pixels have been copied into the staging buffer
+        UniformTexture::_freePixelData(request->pixelData);
+    }
+
+    inFlightBatch.batch->submit();
+    inFlight.push_back(inFlightBatch);
+}
+
+void TextureLoader::completeBatches(bool wait)
+{
+    for (size_t i = 0; i < inFlight.size();)
+    {
+        InFlightBatch &inFlightBatch = inFlight[i];
+
+        if (wait)
+        {
+            inFlightBatch.batch->wait();
+        }
+        else if (!inFlightBatch.batch->isComplete())
+        {
+            i++;
+            continue;
+        }
+
+        for (size_t j = 0; j < inFlightBatch.textures.size(); j++)
+        {
+            inFlightBatch.requests[j]->promise.set_value(inFlightBatch.textures[j]);
+        }
+
+        delete inFlightBatch.batch;
+        inFlight.erase(inFlight.begin() + i);
+    }
+}
+
+void TextureLoader::flush()
+{
+    SHADE_PROFILE_ZONE("TextureLoader::flush");
+
+    {
+        std::unique_lock<std::mutex> lock(decodedMutex);
+        decodeFinished.wait(lock, [this] { return decoding == 0; });
+    }
+
+    recordUploads(true);
+    completeBatches(true);
+}
+
+uint32_t TextureLoader::getPendingCount()
+{
+    uint32_t pending = 0;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        pending = decoding + static_cast<uint32_t>(decoded.size());
+    }
+
+    for (InFlightBatch &inFlightBatch : inFlight)
+    {
+        pending += static_cast<uint32_t>(inFlightBatch.requests.size());
+    }
+
+    return pending;
+}
+
+void TextureLoader::setMaxBytesPerFrame(VkDeviceSize maxBytesPerFrame)
+{
+    this->maxBytesPerFrame = maxBytesPerFrame;
+}
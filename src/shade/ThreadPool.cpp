@@ -0,0 +1,80 @@
+#include "shade/ThreadPool.hpp"
+
+#include <algorithm>
+#include <memory>
+
+using namespace Shade;
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    stopping = false;
+
+    if (threadCount == 0)
+    {
+        // hardware_concurrency may report 0 if unknown
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = std::max(hardwareThreads, 2u) - 1;
+    }
+
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        stopping = true;
+    }
+
+    tasksAvailable.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(tasksMutex);
+            tasksAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            // Drain the queue before exiting
+            if (tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+    }
+}
+
+std::future<void> ThreadPool::enqueue(std::function<void()> task)
+{
+    // std::function requires a copyable target, so the task is shared
+    auto packagedTask = std::make_shared<std::packaged_task<void()>>(task);
+    std::future<void> future = packagedTask->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push([packagedTask] { (*packagedTask)(); });
+    }
+
+    tasksAvailable.notify_one();
+
+    return future;
+}
+
+uint32_t ThreadPool::getThreadCount() { return static_cast<uint32_t>(workers.size()); }
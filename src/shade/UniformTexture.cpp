@@ -3,87 +3,521 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "shade/vendor/stb_image.hpp"
 
+#include "shade/BindlessTextureRegistry.hpp"
 #include "shade/Buffer.hpp"
+#include "shade/CookedTexture.hpp"
+#include "shade/Defragmenter.hpp"
+#include "shade/MipGenerator.hpp"
+#include "shade/Profiler.hpp"
+#include "shade/TextureContainer.hpp"
+#include "shade/TextureFormat.hpp"
+#include "shade/TextureLoader.hpp"
+#include "shade/UploadBatch.hpp"
 
 #include <iostream>
 #include <cmath>
+#include <cstring>
 #include <algorithm>
 
 using namespace Shade;
 
-UniformTexture::UniformTexture(VulkanApplication *app, UniformTexturePixelData pixelData, UniformTextureFilterMode filterMode, bool enableMipmaps)
+// Format of pixel data, which may only describe itself through channels and bpp
+static VkFormat getPixelDataFormat(const UniformTexturePixelData &pixelData)
 {
+	if (pixelData.format != VK_FORMAT_UNDEFINED)
+	{
+		return pixelData.format;
+	}
+
+	if (pixelData.channels > 0 && pixelData.bpp > 0)
+	{
+		VkFormat format = TextureFormat::getUncompressedFormat(pixelData.channels, pixelData.bpp / pixelData.channels);
+		if (format != VK_FORMAT_UNDEFINED)
+		{
+			return format;
+		}
+	}
+
+	// Pixel data used to always be RGBA8
+	return VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+// Whether textures of a format can be sampled with linear filtering, which
+//  Vulkan guarantees for 8-bit UNORM and 16-bit float formats but not for
+//  16-bit UNORM or 32-bit float ones
+static bool canSampleLinear(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+	return (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+}
+
+// Formats stb_image can decode into
+static bool isDecodableFormat(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM:
+	case VK_FORMAT_R8_SRGB:
+	case VK_FORMAT_R8G8_UNORM:
+	case VK_FORMAT_R8G8_SRGB:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_R16_UNORM:
+	case VK_FORMAT_R16G16_UNORM:
+	case VK_FORMAT_R16G16B16A16_UNORM:
+	case VK_FORMAT_R32_SFLOAT:
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+	case VK_FORMAT_R16_SFLOAT:
+	case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Decode an image at full precision (floats if it's HDR, otherwise 16 bits) and
+//  convert it to a float format. The pixels are released with stbi_image_free
+static void *loadConvertedPixels(const std::string &path, VkFormat format, bool hdr, int &width, int &height)
+{
+	int sourceChannels;
+	float *rgba = nullptr;
+
+	if (hdr)
+	{
+		rgba = stbi_loadf(path.c_str(), &width, &height, &sourceChannels, 4);
+	}
+	else
+	{
+		stbi_us *sourcePixels = stbi_load_16(path.c_str(), &width, &height, &sourceChannels, 4);
+		if (sourcePixels != nullptr)
+		{
+			rgba = static_cast<float *>(STBI_MALLOC(static_cast<size_t>(width) * height * 4 * sizeof(float)));
+			TextureFormat::decodePixels(VK_FORMAT_R16G16B16A16_UNORM, sourcePixels, static_cast<size_t>(width) * height, rgba);
+			stbi_image_free(sourcePixels);
+		}
+	}
+
+	if (rgba == nullptr)
+	{
+		return nullptr;
+	}
+
+	void *pixels = STBI_MALLOC(TextureFormat::getLevelSize(format, width, height));
+	TextureFormat::encodePixels(format, rgba, static_cast<size_t>(width) * height, pixels);
+	stbi_image_free(rgba);
+
+	return pixels;
+}
+
+// Generate a full mip chain on the CPU for formats that can't be blitted,
+//  packed for a single copy
+static UniformTextureMipData generateMipChain(VulkanApplicationData *vulkanData, const UniformTextureMipData &mipData, std::vector<uint8_t> &levels)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::generateMipChain");
+
+	MipGenerator mipGenerator(vulkanData->threadPool);
+	const uint8_t *firstLevel = static_cast<const uint8_t *>(mipData.data) + mipData.levelOffsets[0];
+	std::vector<std::vector<uint8_t>> generatedLevels = mipGenerator.generate(firstLevel, mipData.width, mipData.height, mipData.format);
+
+	UniformTextureMipData result = {};
+	result.format = mipData.format;
+	result.width = mipData.width;
+	result.height = mipData.height;
+	result.components = mipData.components;
+
+	// Aligned for copies of any texel size
+	VkDeviceSize size = 0;
+	for (const std::vector<uint8_t> &level : generatedLevels)
+	{
+		size = (size + 15) & ~static_cast<VkDeviceSize>(15);
+		result.levelOffsets.push_back(size);
+		size += level.size();
+	}
+
+	levels.resize(size);
+	for (size_t i = 0; i < generatedLevels.size(); i++)
+	{
+		std::memcpy(levels.data() + result.levelOffsets[i], generatedLevels[i].data(), generatedLevels[i].size());
+	}
+
+	result.data = levels.data();
+	result.size = levels.size();
+	return result;
+}
+
+UniformTexture::UniformTexture(VulkanApplication *app, UniformTexturePixelData pixelData, UniformTextureFilterMode filterMode, bool enableMipmaps, UploadBatch *uploadBatch)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::UniformTexture");
+
+	UniformTextureMipData mipData = {};
+	mipData.format = getPixelDataFormat(pixelData);
+	mipData.width = pixelData.width;
+	mipData.height = pixelData.height;
+	mipData.data = pixelData.pixels;
+	mipData.size = TextureFormat::getLevelSize(mipData.format, pixelData.width, pixelData.height);
+	mipData.levelOffsets = {0};
+	if (pixelData.greyscale)
+	{
+		VkComponentSwizzle alpha = pixelData.channels == 2 ? VK_COMPONENT_SWIZZLE_G : VK_COMPONENT_SWIZZLE_ONE;
+		mipData.components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, alpha};
+	}
+
+	// A format derived from channels and bpp wasn't asked for, so rather than
+	//  failing on devices that can't filter it, convert to one every device can
+	std::vector<uint8_t> convertedPixels;
+	if (pixelData.format == VK_FORMAT_UNDEFINED && !canSampleLinear(app->_getVulkanData()->physicalDevice, mipData.format))
+	{
+		VkFormat fallbackFormat = TextureFormat::getInfo(mipData.format).channelBits > 8 ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
+		size_t pixelCount = static_cast<size_t>(pixelData.width) * pixelData.height;
+		std::vector<float> rgba(pixelCount * 4);
+		TextureFormat::decodePixels(mipData.format, pixelData.pixels, pixelCount, rgba.data());
+
+		mipData.format = fallbackFormat;
+		mipData.size = TextureFormat::getLevelSize(fallbackFormat, pixelData.width, pixelData.height);
+		convertedPixels.resize(mipData.size);
+		TextureFormat::encodePixels(fallbackFormat, rgba.data(), pixelCount, convertedPixels.data());
+		mipData.data = convertedPixels.data();
+	}
+
+	createTexture(app, mipData, enableMipmaps, filterMode, uploadBatch);
+}
+
+UniformTexture::UniformTexture(VulkanApplication *app, const UniformTextureMipData &mipData, UniformTextureFilterMode filterMode, UploadBatch *uploadBatch)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::UniformTexture");
+
+	createTexture(app, mipData, false, filterMode, uploadBatch);
+}
+
+void UniformTexture::createTexture(VulkanApplication *app, const UniformTextureMipData &suppliedMipData, bool generateMipmaps, UniformTextureFilterMode filterMode, UploadBatch *uploadBatch)
+{
+	this->app = app;
 	this->vulkanData = app->_getVulkanData();
 
-	uint32_t stride = pixelData.width * pixelData.height * 4;
+	if (TextureFormat::isBlockCompressed(suppliedMipData.format) && !vulkanData->textureCompressionBC)
+	{
+		throw std::runtime_error("Shade: Block-compressed textures aren't supported by the device!");
+	}
 
-	// Create staging buffer
-	Buffer stagingBuffer = Buffer(app, pixelData.pixels, stride, 1, TRANSFER);
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(vulkanData->physicalDevice, suppliedMipData.format, &formatProperties);
+	if ((formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+	{
+		throw std::runtime_error("Shade: Texture format isn't supported by the device!");
+	}
 
-	uint32_t mipLevels = 1;
-	VkImageUsageFlags usageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	// Mipmaps are generated with linear filtered blits, or on the CPU and
+	//  uploaded with the first level when the format can't be blitted
+	UniformTextureMipData generatedMipData;
+	std::vector<uint8_t> generatedLevels;
+	VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if (generateMipmaps && (formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures)
+	{
+		if (TextureFormat::isConvertible(suppliedMipData.format))
+		{
+			generatedMipData = generateMipChain(vulkanData, suppliedMipData, generatedLevels);
+		}
+		else
+		{
+			std::cout << "Shade: (Warning) Texture format doesn't support linear blits, mipmaps won't be generated" << std::endl;
+		}
+		generateMipmaps = false;
+	}
+	const UniformTextureMipData &mipData = generatedLevels.empty() ? suppliedMipData : generatedMipData;
 
-	if (enableMipmaps)
+	// Record into our own batch when none was given, still a single submission
+	UploadBatch *ownBatch = nullptr;
+	if (uploadBatch == nullptr)
 	{
-		// Calculate mip levels
-		mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(pixelData.width, pixelData.height)))) + 1;
+		ownBatch = new UploadBatch(app);
+		uploadBatch = ownBatch;
+	}
+	VkCommandBuffer commandBuffer = uploadBatch->_getCommandBuffer();
+
+	// Create staging buffer holding every supplied level, released by the
+	//  batch once the copy has completed
+	Buffer *stagingBuffer = new Buffer(app, const_cast<void *>(mipData.data), static_cast<uint32_t>(mipData.size), 1, TRANSFER);
+	uploadBatch->_addStagingBuffer(stagingBuffer);
 
-		usageFlags |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	format = mipData.format;
+	components = mipData.components;
+	width = mipData.width;
+	height = mipData.height;
+	mipLevels = static_cast<uint32_t>(mipData.levelOffsets.size());
+
+	// Transfer source for mipmap generation and defragmentation copies
+	usageFlags = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	if (generateMipmaps)
+	{
+		// Calculate mip levels
+		mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
 	}
 
-	app->_createImage(pixelData.width, pixelData.height,
-					  VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+	app->_createImage(width, height,
+					  format, VK_IMAGE_TILING_OPTIMAL,
 					  usageFlags,
-					  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, mipLevels);
+					  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation, mipLevels);
+
+	std::vector<VkBufferImageCopy> regions(mipData.levelOffsets.size());
+	for (uint32_t i = 0; i < regions.size(); i++)
+	{
+		regions[i] = {};
+		regions[i].bufferOffset = mipData.levelOffsets[i];
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.mipLevel = i;
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = 1;
+		regions[i].imageExtent = {std::max(width >> i, 1u), std::max(height >> i, 1u), 1};
+	}
 
-	app->_transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-	app->_copyBufferToImage(stagingBuffer._getVkBuffer(), textureImage, static_cast<uint32_t>(pixelData.width), static_cast<uint32_t>(pixelData.height));
-	if (enableMipmaps)
+	app->_transitionImageLayout(textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, commandBuffer);
+	app->_copyBufferToImage(stagingBuffer->_getVkBuffer(), textureImage, regions, commandBuffer);
+	if (generateMipmaps)
 	{
-		app->_generateMipmaps(textureImage, pixelData.width, pixelData.height, mipLevels);
+		app->_generateMipmaps(textureImage, width, height, mipLevels, commandBuffer);
 	}
 	else
 	{
-		app->_transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		app->_transitionImageLayout(textureImage, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels, commandBuffer);
 	}
 
 	// Create image view
-	app->_createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, textureImageView, mipLevels);
+	app->_createImageView(textureImage, format, VK_IMAGE_ASPECT_COLOR_BIT, textureImageView, mipLevels, components);
 
 	// Create texture sampler
 	createTextureSampler(filterMode, mipLevels);
+
+	// Make the texture available to bindless shaders
+	bindlessIndex = 0;
+	if (vulkanData->bindlessTextures != nullptr)
+	{
+		bindlessIndex = vulkanData->bindlessTextures->registerTexture(textureImageView, textureSampler);
+	}
+
+	relocationImage = VK_NULL_HANDLE;
+	relocationAllocation = VK_NULL_HANDLE;
+
+	resident = false;
+	this->uploadBatch = uploadBatch;
+	uploadBatch->_addTexture(this);
+
+	if (ownBatch != nullptr)
+	{
+		ownBatch->wait();
+		delete ownBatch;
+	}
 }
 
 UniformTexture::~UniformTexture()
 {
+	// The GPU may still be writing to the image
+	if (!resident)
+	{
+		uploadBatch->wait();
+	}
+
+	if (vulkanData->defragmenter != nullptr)
+	{
+		vulkanData->defragmenter->_unregisterTexture(this);
+	}
+
+	if (vulkanData->bindlessTextures != nullptr)
+	{
+		vulkanData->bindlessTextures->unregisterTexture(bindlessIndex);
+	}
+
 	vkDestroySampler(vulkanData->device, textureSampler, nullptr);
 	vkDestroyImageView(vulkanData->device, textureImageView, nullptr);
-	vkDestroyImage(vulkanData->device, textureImage, nullptr);
-	vkFreeMemory(vulkanData->device, textureImageMemory, nullptr);
+	app->_destroyImage(textureImage, textureImageAllocation, MEMORY_CATEGORY_TEXTURE);
 }
 
-UniformTexture *UniformTexture::loadFromPath(VulkanApplication *app, std::string path, UniformTextureFilterMode filterMode, bool enableMipmaps)
+UniformTexture *UniformTexture::loadFromPath(VulkanApplication *app, std::string path, UniformTextureFilterMode filterMode, bool enableMipmaps, UploadBatch *uploadBatch, VkFormat format)
 {
-	UniformTexturePixelData pixelData = {};
+	SHADE_PROFILE_ZONE("UniformTexture::loadFromPath");
 
 	// Load image at path
-	pixelData.pixels = stbi_load(path.c_str(), &pixelData.width, &pixelData.height,
-								 &pixelData.channels, STBI_rgb_alpha);
+	UniformTexturePixelData pixelData = _loadPixelData(path, format, app->_getVulkanData()->physicalDevice);
 
-	if (!pixelData.pixels)
+	// Create texture
+	UniformTexture *texture;
+	try
 	{
-		throw std::runtime_error("Shade: Failed to load uniform texture!");
+		texture = new UniformTexture(app, pixelData, filterMode, enableMipmaps, uploadBatch);
+	}
+	catch (...)
+	{
+		_freePixelData(pixelData);
+		throw;
 	}
-
-	// Create texture
-	UniformTexture *texture = new UniformTexture(app, pixelData, filterMode, enableMipmaps);
 
 	// Free original image
-	stbi_image_free(pixelData.pixels);
+	_freePixelData(pixelData);
 
 	return texture;
 }
 
+UniformTexture *UniformTexture::loadFromCooked(VulkanApplication *app, std::string path, UniformTextureFilterMode filterMode, UploadBatch *uploadBatch)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::loadFromCooked");
+
+	CookedTexture cookedTexture(path);
+	const CookedTextureHeader &header = cookedTexture.getHeader();
+
+	// Levels are stored back to back, stage them with a single copy
+	const uint8_t *firstLevel = cookedTexture.getLevelData(0);
+	const CookedTextureLevel &lastLevel = cookedTexture.getLevel(header.mipLevels - 1);
+
+	UniformTextureMipData mipData = {};
+	mipData.format = static_cast<VkFormat>(header.format);
+	mipData.width = header.width;
+	mipData.height = header.height;
+	mipData.data = firstLevel;
+	mipData.size = lastLevel.offset + lastLevel.size - cookedTexture.getLevel(0).offset;
+
+	for (uint32_t i = 0; i < header.mipLevels; i++)
+	{
+		mipData.levelOffsets.push_back(cookedTexture.getLevelData(i) - firstLevel);
+	}
+
+	return new UniformTexture(app, mipData, filterMode, uploadBatch);
+}
+
+UniformTexture *UniformTexture::loadFromContainer(VulkanApplication *app, std::string path, UniformTextureFilterMode filterMode, UploadBatch *uploadBatch)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::loadFromContainer");
+
+	TextureContainer container(path);
+
+	return new UniformTexture(app, container.getMipData(), filterMode, uploadBatch);
+}
+
+std::vector<UniformTexture *> UniformTexture::loadFromPaths(VulkanApplication *app, const std::vector<std::string> &paths, UniformTextureFilterMode filterMode, bool enableMipmaps, VkFormat format)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::loadFromPaths");
+
+	TextureLoader *textureLoader = app->_getVulkanData()->textureLoader;
+
+	std::vector<std::shared_future<UniformTexture *>> futures = textureLoader->loadBatch(paths, filterMode, enableMipmaps, format);
+	textureLoader->flush();
+
+	std::vector<UniformTexture *> textures;
+	std::exception_ptr error;
+	for (std::shared_future<UniformTexture *> &future : futures)
+	{
+		try
+		{
+			textures.push_back(future.get());
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+	}
+
+	// Don't leak the textures that did load
+	if (error)
+	{
+		for (UniformTexture *texture : textures)
+		{
+			delete texture;
+		}
+		std::rethrow_exception(error);
+	}
+
+	return textures;
+}
+
+std::shared_future<UniformTexture *> UniformTexture::loadFromPathAsync(VulkanApplication *app, std::string path, UniformTextureFilterMode filterMode, bool enableMipmaps, VkFormat format)
+{
+	return app->_getVulkanData()->textureLoader->load(path, filterMode, enableMipmaps, format);
+}
+
+std::vector<std::shared_future<UniformTexture *>> UniformTexture::loadFromPathsAsync(VulkanApplication *app, const std::vector<std::string> &paths, UniformTextureFilterMode filterMode, bool enableMipmaps, VkFormat format)
+{
+	return app->_getVulkanData()->textureLoader->loadBatch(paths, filterMode, enableMipmaps, format);
+}
+
+UniformTexturePixelData UniformTexture::_loadPixelData(std::string path, VkFormat format, VkPhysicalDevice physicalDevice)
+{
+	SHADE_PROFILE_ZONE("UniformTexture::_loadPixelData");
+
+	int sourceChannels;
+	UniformTexturePixelData pixelData = {};
+	bool hdr = stbi_is_hdr(path.c_str()) != 0;
+
+	if (!stbi_info(path.c_str(), &pixelData.width, &pixelData.height, &sourceChannels))
+	{
+		throw std::runtime_error("Shade: Failed to load uniform texture '" + path + "'!");
+	}
+
+	if (format == VK_FORMAT_UNDEFINED)
+	{
+		// Keep the image's channels and precision, RGB isn't widely supported.
+		//  HDR images are stored as half floats, keeping their range at half
+		//  the size of 32-bit floats
+		uint32_t channels = sourceChannels == 3 ? 4 : sourceChannels;
+		uint32_t channelBits = stbi_is_16_bit(path.c_str()) ? 16 : 8;
+		format = hdr ? VK_FORMAT_R16G16B16A16_SFLOAT : TextureFormat::getUncompressedFormat(channels, channelBits);
+
+		// 16-bit PNGs are kept as UNORM only where the device can filter it.
+		//  Half floats are always sampled, filtered and blitted, and are used
+		//  when the device isn't known
+		if (channelBits == 16 && (physicalDevice == VK_NULL_HANDLE || !canSampleLinear(physicalDevice, format)))
+		{
+			format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		}
+		pixelData.greyscale = !hdr && TextureFormat::getInfo(format).channels <= 2;
+	}
+
+	if (!isDecodableFormat(format))
+	{
+		throw std::runtime_error("Shade: Can't load uniform texture '" + path + "' into the requested format!");
+	}
+
+	TextureFormatInfo formatInfo = TextureFormat::getInfo(format);
+	pixelData.format = format;
+	pixelData.channels = formatInfo.channels;
+	pixelData.bpp = formatInfo.blockSize * 8;
+
+	// stb_image converts between channel counts and integer precisions, and
+	//  HDR images to 32-bit floats. Other float formats are converted by Shade
+	int channels = static_cast<int>(formatInfo.channels);
+	if (formatInfo.floatingPoint && !(hdr && formatInfo.channelBits == 32))
+	{
+		pixelData.pixels = loadConvertedPixels(path, format, hdr, pixelData.width, pixelData.height);
+	}
+	else if (formatInfo.channelBits == 8)
+	{
+		pixelData.pixels = stbi_load(path.c_str(), &pixelData.width, &pixelData.height, &sourceChannels, channels);
+	}
+	else if (formatInfo.channelBits == 16)
+	{
+		pixelData.pixels = stbi_load_16(path.c_str(), &pixelData.width, &pixelData.height, &sourceChannels, channels);
+	}
+	else
+	{
+		pixelData.pixels = stbi_loadf(path.c_str(), &pixelData.width, &pixelData.height, &sourceChannels, channels);
+	}
+
+	if (!pixelData.pixels)
+	{
+		throw std::runtime_error("Shade: Failed to load uniform texture '" + path + "'!");
+	}
+
+	return pixelData;
+}
+
+void UniformTexture::_freePixelData(UniformTexturePixelData &pixelData)
+{
+	stbi_image_free(pixelData.pixels);
+	pixelData.pixels = nullptr;
+}
+
 void UniformTexture::createTextureSampler(UniformTextureFilterMode filterMode, uint32_t mipLevels)
 {
 	VkSamplerCreateInfo samplerInfo = {};
@@ -133,4 +567,152 @@ VkImageView UniformTexture::_getTextureImageView()
 VkSampler UniformTexture::_getTextureSampler()
 {
 	return this->textureSampler;
-}
\ No newline at end of file
+}
+
+uint32_t UniformTexture::getBindlessIndex()
+{
+	return this->bindlessIndex;
+}
+
+bool UniformTexture::isResident()
+{
+	if (!resident)
+	{
+		// Completing the batch marks the texture resident
+		uploadBatch->isComplete();
+	}
+
+	return resident;
+}
+
+void UniformTexture::_markResident()
+{
+	resident = true;
+	uploadBatch = nullptr;
+
+	// The defragmenter may only move textures that are fully uploaded
+	if (vulkanData->defragmenter != nullptr)
+	{
+		vulkanData->defragmenter->_registerTexture(this);
+	}
+}
+
+VkDeviceSize UniformTexture::_getAllocationSize()
+{
+	VmaAllocationInfo allocationInfo;
+	vmaGetAllocationInfo(vulkanData->allocator, textureImageAllocation, &allocationInfo);
+
+	return allocationInfo.size;
+}
+
+bool UniformTexture::_beginRelocation(VkCommandBuffer commandBuffer)
+{
+	VkImageCreateInfo imageInfo = VulkanApplication::_getImageCreateInfo(width, height, format, VK_IMAGE_TILING_OPTIMAL, usageFlags, mipLevels);
+
+	if (vkCreateImage(vulkanData->device, &imageInfo, nullptr, &relocationImage) != VK_SUCCESS)
+	{
+		relocationImage = VK_NULL_HANDLE;
+		return false;
+	}
+
+	// Only use free space in existing blocks; VMA tries the fullest blocks first
+	VmaAllocationCreateInfo allocInfo = {};
+	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_NEVER_ALLOCATE_BIT;
+
+	VmaAllocationInfo currentInfo;
+	vmaGetAllocationInfo(vulkanData->allocator, textureImageAllocation, &currentInfo);
+
+	VmaAllocationInfo relocationInfo;
+	bool allocated = vmaAllocateMemoryForImage(vulkanData->allocator, relocationImage, &allocInfo, &relocationAllocation, &relocationInfo) == VK_SUCCESS;
+
+	// Moving within the same block wouldn't help to release it
+	if (!allocated || relocationInfo.deviceMemory == currentInfo.deviceMemory)
+	{
+		if (allocated)
+		{
+			vmaFreeMemory(vulkanData->allocator, relocationAllocation);
+		}
+		vkDestroyImage(vulkanData->device, relocationImage, nullptr);
+
+		relocationImage = VK_NULL_HANDLE;
+		relocationAllocation = VK_NULL_HANDLE;
+		return false;
+	}
+
+	vmaBindImageMemory(vulkanData->allocator, relocationAllocation, relocationImage);
+
+	VkImageMemoryBarrier barriers[2] = {};
+	for (VkImageMemoryBarrier &barrier : barriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+	}
+
+	// The old image is only read by the copy, the new one is fully overwritten
+	barriers[0].image = textureImage;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcAccessMask = 0;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	barriers[1].image = relocationImage;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+	std::vector<VkImageCopy> regions(mipLevels);
+	for (uint32_t i = 0; i < mipLevels; i++)
+	{
+		regions[i] = {};
+		regions[i].srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].srcSubresource.mipLevel = i;
+		regions[i].srcSubresource.baseArrayLayer = 0;
+		regions[i].srcSubresource.layerCount = 1;
+		regions[i].dstSubresource = regions[i].srcSubresource;
+		regions[i].extent.width = std::max(width >> i, 1u);
+		regions[i].extent.height = std::max(height >> i, 1u);
+		regions[i].extent.depth = 1;
+	}
+
+	vkCmdCopyImage(commandBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, relocationImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, regions.data());
+
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barriers[1]);
+
+	return true;
+}
+
+void UniformTexture::_finishRelocation()
+{
+	vkDestroyImageView(vulkanData->device, textureImageView, nullptr);
+	app->_destroyImage(textureImage, textureImageAllocation, MEMORY_CATEGORY_TEXTURE);
+
+	textureImage = relocationImage;
+	textureImageAllocation = relocationAllocation;
+	relocationImage = VK_NULL_HANDLE;
+	relocationAllocation = VK_NULL_HANDLE;
+
+	vulkanData->memoryStatistics->_trackAllocation(MEMORY_CATEGORY_TEXTURE, _getAllocationSize());
+
+	app->_createImageView(textureImage, format, VK_IMAGE_ASPECT_COLOR_BIT, textureImageView, mipLevels, components);
+
+	if (vulkanData->bindlessTextures != nullptr)
+	{
+		vulkanData->bindlessTextures->updateTexture(bindlessIndex, textureImageView, textureSampler);
+	}
+}
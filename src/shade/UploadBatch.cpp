@@ -0,0 +1,119 @@
+#include "shade/UploadBatch.hpp"
+
+#include "shade/Buffer.hpp"
+#include "shade/Profiler.hpp"
+#include "shade/RenderCounters.hpp"
+#include "shade/UniformTexture.hpp"
+
+using namespace Shade;
+
+UploadBatch::UploadBatch(VulkanApplication *app)
+{
+    this->app = app;
+    this->vulkanData = app->_getVulkanData();
+
+    commandBuffer = app->_beginSingleTimeCommands();
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (vkCreateFence(vulkanData->device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to create upload batch fence!");
+    }
+
+    submitted = false;
+    completed = false;
+}
+
+UploadBatch::~UploadBatch()
+{
+    wait();
+
+    vkDestroyFence(vulkanData->device, fence, nullptr);
+    vkFreeCommandBuffers(vulkanData->device, vulkanData->commandPool, 1, &commandBuffer);
+}
+
+VkCommandBuffer UploadBatch::_getCommandBuffer()
+{
+    if (submitted)
+    {
+        throw std::runtime_error("Shade: Can't record into an upload batch that was submitted!");
+    }
+
+    return commandBuffer;
+}
+
+void UploadBatch::_addStagingBuffer(Buffer *buffer) { stagingBuffers.push_back(buffer); }
+
+void UploadBatch::_addTexture(UniformTexture *texture) { textures.push_back(texture); }
+
+void UploadBatch::submit()
+{
+    SHADE_PROFILE_ZONE("UploadBatch::submit");
+
+    if (submitted)
+    {
+        return;
+    }
+
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    if (vkQueueSubmit(vulkanData->graphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Shade: Failed to submit upload batch!");
+    }
+
+    submitted = true;
+}
+
+bool UploadBatch::isComplete()
+{
+    if (!completed && submitted && vkGetFenceStatus(vulkanData->device, fence) == VK_SUCCESS)
+    {
+        finish();
+    }
+
+    return completed;
+}
+
+void UploadBatch::wait()
+{
+    SHADE_PROFILE_ZONE("UploadBatch::wait");
+
+    submit();
+
+    if (isComplete())
+    {
+        return;
+    }
+
+    vkWaitForFences(vulkanData->device, 1, &fence, VK_TRUE, UINT64_MAX);
+    AtomicRenderCounters::add(vulkanData->renderCounters->singleTimeCommandStalls);
+
+    finish();
+}
+
+bool UploadBatch::isSubmitted() { return submitted; }
+
+void UploadBatch::finish()
+{
+    for (Buffer *buffer : stagingBuffers)
+    {
+        delete buffer;
+    }
+    stagingBuffers.clear();
+
+    for (UniformTexture *texture : textures)
+    {
+        texture->_markResident();
+    }
+    textures.clear();
+
+    completed = true;
+}
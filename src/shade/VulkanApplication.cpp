@@ -1,4 +1,5 @@
 #include "shade/VulkanApplication.hpp"
+#include "shade/RenderCounters.hpp"
 
 #include <iostream>
 
@@ -23,13 +24,11 @@ uint32_t VulkanApplication::_findMemoryType(uint32_t typeFilter,
     throw std::runtime_error("Shade: Failed to find suitable memory type!");
 }
 
-void VulkanApplication::_createImage(uint32_t width, uint32_t height,
-                                     VkFormat format, VkImageTiling tiling,
-                                     VkImageUsageFlags usage,
-                                     VkMemoryPropertyFlags properties,
-                                     VkImage &image, VkDeviceMemory &imageMemory, uint32_t mipLevels)
+VkImageCreateInfo VulkanApplication::_getImageCreateInfo(uint32_t width, uint32_t height,
+                                                         VkFormat format, VkImageTiling tiling,
+                                                         VkImageUsageFlags usage,
+                                                         uint32_t mipLevels)
 {
-
     VkImageCreateInfo imageInfo = {};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -45,28 +44,54 @@ void VulkanApplication::_createImage(uint32_t width, uint32_t height,
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateImage(vulkanData.device, &imageInfo, nullptr, &image) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Shade: Failed to create image!");
-    }
+    return imageInfo;
+}
+
+void VulkanApplication::_createImage(uint32_t width, uint32_t height,
+                                     VkFormat format, VkImageTiling tiling,
+                                     VkImageUsageFlags usage,
+                                     VkMemoryPropertyFlags properties,
+                                     VkImage &image, VmaAllocation &imageAllocation,
+                                     uint32_t mipLevels, MemoryCategory category)
+{
+    VkImageCreateInfo imageInfo =
+        _getImageCreateInfo(width, height, format, tiling, usage, mipLevels);
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(vulkanData.device, image, &memRequirements);
+    // Images are sub-allocated from VMA's memory blocks, so thousands of
+    //  textures don't each use one of the limited device memory allocations
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags = properties;
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = _findMemoryType(memRequirements.memoryTypeBits, properties);
+    if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+    {
+        // Render targets are large and recreated with the swapchain, give them
+        //  their own memory rather than fragmenting the shared blocks
+        allocInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    }
 
-    if (vkAllocateMemory(vulkanData.device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+    VmaAllocationInfo allocationInfo;
+    if (vmaCreateImage(vulkanData.allocator, &imageInfo, &allocInfo, &image, &imageAllocation,
+                       &allocationInfo) != VK_SUCCESS)
     {
-        throw std::runtime_error("Shade: Failed to allocate image memory!");
+        throw std::runtime_error("Shade: Failed to create image!");
     }
 
-    vkBindImageMemory(vulkanData.device, image, imageMemory, 0);
+    vulkanData.memoryStatistics->_trackAllocation(category, allocationInfo.size);
+}
+
+void VulkanApplication::_destroyImage(VkImage image, VmaAllocation imageAllocation,
+                                      MemoryCategory category)
+{
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(vulkanData.allocator, imageAllocation, &allocationInfo);
+    vulkanData.memoryStatistics->_trackFree(category, allocationInfo.size);
+
+    vmaDestroyImage(vulkanData.allocator, image, imageAllocation);
 }
 
-void VulkanApplication::_createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView &imageView, uint32_t mipLevels)
+void VulkanApplication::_createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, VkImageView &imageView, uint32_t mipLevels,
+                                         VkComponentMapping components)
 {
     // Create image view
     VkImageViewCreateInfo viewInfo = {};
@@ -74,6 +99,7 @@ void VulkanApplication::_createImageView(VkImage image, VkFormat format, VkImage
     viewInfo.image = image;
     viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
     viewInfo.format = format;
+    viewInfo.components = components;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
     viewInfo.subresourceRange.levelCount = mipLevels;
@@ -86,9 +112,15 @@ void VulkanApplication::_createImageView(VkImage image, VkFormat format, VkImage
     }
 }
 
-void VulkanApplication::_generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels)
+void VulkanApplication::_generateMipmaps(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+                                         VkCommandBuffer commandBuffer)
 {
-    VkCommandBuffer commandBuffer = _beginSingleTimeCommands();
+    // Record into the caller's command buffer, or submit on our own
+    bool singleTime = commandBuffer == VK_NULL_HANDLE;
+    if (singleTime)
+    {
+        commandBuffer = _beginSingleTimeCommands();
+    }
 
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -167,7 +199,10 @@ void VulkanApplication::_generateMipmaps(VkImage image, uint32_t width, uint32_t
                          0, nullptr,
                          1, &barrier);
 
-    _endSingleTimeCommands(commandBuffer);
+    if (singleTime)
+    {
+        _endSingleTimeCommands(commandBuffer);
+    }
 }
 
 VkCommandBuffer VulkanApplication::_beginSingleTimeCommands()
@@ -201,6 +236,7 @@ void VulkanApplication::_endSingleTimeCommands(VkCommandBuffer commandBuffer)
 
     vkQueueSubmit(vulkanData.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
     vkQueueWaitIdle(vulkanData.graphicsQueue);
+    AtomicRenderCounters::add(vulkanData.renderCounters->singleTimeCommandStalls);
 
     vkFreeCommandBuffers(vulkanData.device, vulkanData.commandPool, 1, &commandBuffer);
 }
@@ -216,40 +252,33 @@ void VulkanApplication::_copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDe
     _endSingleTimeCommands(commandBuffer);
 }
 
-void VulkanApplication::_copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void VulkanApplication::_copyBufferToImage(VkBuffer buffer, VkImage image,
+                                           const std::vector<VkBufferImageCopy> &regions,
+                                           VkCommandBuffer commandBuffer)
 {
-    VkCommandBuffer commandBuffer = _beginSingleTimeCommands();
-
-    VkBufferImageCopy region = {};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {
-        width,
-        height,
-        1};
+    bool singleTime = commandBuffer == VK_NULL_HANDLE;
+    if (singleTime)
+    {
+        commandBuffer = _beginSingleTimeCommands();
+    }
 
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region);
+    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()), regions.data());
 
-    _endSingleTimeCommands(commandBuffer);
+    if (singleTime)
+    {
+        _endSingleTimeCommands(commandBuffer);
+    }
 }
 
-void VulkanApplication::_transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels)
+void VulkanApplication::_transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels,
+                                               VkCommandBuffer commandBuffer)
 {
-    VkCommandBuffer commandBuffer = _beginSingleTimeCommands();
+    bool singleTime = commandBuffer == VK_NULL_HANDLE;
+    if (singleTime)
+    {
+        commandBuffer = _beginSingleTimeCommands();
+    }
 
     VkImageMemoryBarrier barrier = {};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -320,5 +349,8 @@ void VulkanApplication::_transitionImageLayout(VkImage image, VkFormat format, V
         0, nullptr,
         1, &barrier);
 
-    _endSingleTimeCommands(commandBuffer);
+    if (singleTime)
+    {
+        _endSingleTimeCommands(commandBuffer);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <shade/CookedTexture.hpp>
+#include <shade/MipGenerator.hpp>
+#include <shade/TextureEncoder.hpp>
+#include <shade/TextureFormat.hpp>
+#include <shade/ThreadPool.hpp>
+#include <shade/vendor/stb_image.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace Shade;
+
+static void printUsage()
+{
+    std::cout << "Usage: TextureCooker [options] <input image> <output .stex>" << std::endl
+              << "Options:" << std::endl
+              << "  --no-mipmaps  only store the full size image" << std::endl
+              << "  --format <rgba8|bc1|bc1a|bc3|bc4|bc5|bc7>  format to store (default rgba8)"
+              << std::endl
+              << "  --srgb  store colour in an sRGB format (rgba8, bc1, bc1a, bc3 and bc7)"
+              << std::endl
+              << "  --quality <fast|normal|high>  block compression quality (default normal)"
+              << std::endl
+              << "  --mip-filter <box|kaiser>  filter used to generate mipmaps (default box)"
+              << std::endl
+              << "  --no-alpha-weighting  filter colour independently of alpha, for images"
+              << std::endl
+              << "      whose alpha channel isn't opacity" << std::endl;
+}
+
+// Formats selectable on the command line, as their UNORM and sRGB variants
+static const std::map<std::string, std::pair<VkFormat, VkFormat>> formats = {
+    {"rgba8", {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB}},
+    {"bc1", {VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK}},
+    {"bc1a", {VK_FORMAT_BC1_RGBA_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK}},
+    {"bc3", {VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK}},
+    {"bc4", {VK_FORMAT_BC4_UNORM_BLOCK, VK_FORMAT_UNDEFINED}},
+    {"bc5", {VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_UNDEFINED}},
+    {"bc7", {VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK}}};
+
+static const std::map<std::string, TextureEncoderQuality> qualities = {
+    {"fast", TEXTURE_ENCODER_QUALITY_FAST},
+    {"normal", TEXTURE_ENCODER_QUALITY_NORMAL},
+    {"high", TEXTURE_ENCODER_QUALITY_HIGH}};
+
+static const std::map<std::string, MipFilter> mipFilters = {{"box", MIP_FILTER_BOX},
+                                                            {"kaiser", MIP_FILTER_KAISER}};
+
+int main(int argc, char **argv)
+{
+    bool mipmaps = true;
+    bool srgb = false;
+    bool alphaWeighted = true;
+    std::string formatName = "rgba8";
+    std::string qualityName = "normal";
+    std::string mipFilterName = "box";
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--no-mipmaps") == 0)
+        {
+            mipmaps = false;
+        }
+        else if (std::strcmp(argv[i], "--srgb") == 0)
+        {
+            srgb = true;
+        }
+        else if (std::strcmp(argv[i], "--no-alpha-weighting") == 0)
+        {
+            alphaWeighted = false;
+        }
+        else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            formatName = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--quality") == 0 && i + 1 < argc)
+        {
+            qualityName = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--mip-filter") == 0 && i + 1 < argc)
+        {
+            mipFilterName = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.size() != 2 || formats.count(formatName) == 0 || qualities.count(qualityName) == 0 ||
+        mipFilters.count(mipFilterName) == 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    VkFormat format = srgb ? formats.at(formatName).second : formats.at(formatName).first;
+    if (format == VK_FORMAT_UNDEFINED)
+    {
+        std::cout << "There is no sRGB variant of " << formatName << std::endl;
+        return 1;
+    }
+
+    int width, height, channels;
+    stbi_uc *pixels = stbi_load(paths[0].c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == nullptr)
+    {
+        std::cout << "Failed to load " << paths[0] << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+
+    // Mipmaps are filtered in linear space when the stored format is sRGB
+    VkFormat pixelFormat =
+        TextureFormat::isSRGB(format) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+
+    ThreadPool threadPool;
+    std::vector<std::vector<uint8_t>> levels;
+
+    try
+    {
+        if (mipmaps)
+        {
+            MipGenerator mipGenerator(&threadPool, mipFilters.at(mipFilterName), alphaWeighted);
+            levels = mipGenerator.generate(pixels, width, height, pixelFormat);
+        }
+        else
+        {
+            levels.emplace_back(pixels, pixels + width * height * 4);
+        }
+        stbi_image_free(pixels);
+
+        if (TextureEncoder::isSupportedFormat(format))
+        {
+            TextureEncoder encoder(&threadPool, qualities.at(qualityName));
+
+            for (size_t i = 0; i < levels.size(); i++)
+            {
+                levels[i] = encoder.encode(levels[i].data(), std::max(width >> i, 1),
+                                           std::max(height >> i, 1), format);
+            }
+        }
+
+        CookedTexture::write(paths[1], format, width, height, levels);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}